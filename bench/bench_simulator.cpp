@@ -0,0 +1,193 @@
+/**
+ * @file bench_simulator.cpp
+ * @brief Simulator benchmarks.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "../src/arena.hpp"
+#include "../src/behavior.hpp"
+#include "../src/scenario.hpp"
+#include "../src/simulator.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Vehicles constructed per benchmark, spread over the iterations. */
+constexpr long BENCH_TOTAL_VEHICLES = 50000000;
+
+constexpr int BENCH_FLEET_SIZES[] = {20, 1000, 100000};
+
+/** @brief Fleets to compare warming up against loading a fleet image. */
+constexpr int BENCH_WARM_START_FLEET_SIZES[] = {20, 1000, 10000};
+
+/** @brief Sim time spent warming up before a query (ms). */
+constexpr long long BENCH_WARM_UP_MS = MS_PER_HOUR;
+
+/** @brief Fleet image loads per benchmark. */
+constexpr int BENCH_IMAGE_LOADS = 100;
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Seconds elapsed since `start`.
+ */
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+/**
+ * @brief Construct and tear down simulators that each own their memory.
+ * @param fleet_size Vehicles per simulator
+ * @param iterations Number of simulators to construct
+ */
+static double bench_owned(int fleet_size, int iterations) {
+  auto start = std::chrono::steady_clock::now();
+  long sink = 0;
+
+  for (int i = 0; i < iterations; i++) {
+    Simulator sim(fleet_size, i + 1);
+    sink += sim.ticks();
+  }
+
+  double elapsed = seconds_since(start);
+  return sink >= 0 ? iterations / elapsed : 0;
+}
+
+/**
+ * @brief Construct and tear down simulators in one arena, reset between runs.
+ * @param fleet_size Vehicles per simulator
+ * @param iterations Number of simulators to construct
+ * @param huge_pages Place the arena on huge pages
+ */
+static double bench_arena(int fleet_size, int iterations, bool huge_pages) {
+  Arena arena(Simulator::arena_bytes(fleet_size), huge_pages);
+  auto start = std::chrono::steady_clock::now();
+  long sink = 0;
+
+  for (int i = 0; i < iterations; i++) {
+    Simulator sim(fleet_size, i + 1, POLICY__FIFO, &arena);
+    sink += sim.ticks();
+    arena.reset();
+  }
+
+  double elapsed = seconds_since(start);
+  return sink >= 0 ? iterations / elapsed : 0;
+}
+
+/**
+ * @brief Compare warming a fleet up by simulating against loading the
+ * warmed-up fleet from an image, up to the end of the first query tick.
+ * @param fleet_size Vehicles in the fleet
+ */
+static void bench_warm_start(int fleet_size) {
+  std::string path = "/tmp/bench_fleet_" + std::to_string(fleet_size) + ".img";
+  SimulatorConfig config;
+  config.vehicle_count = fleet_size;
+
+  auto start = std::chrono::steady_clock::now();
+  Simulator warm(config);
+  warm.simulate(BENCH_WARM_UP_MS);
+  warm.step();
+  double warm_up = seconds_since(start);
+
+  if (!warm.save_image(path.c_str())) {
+    return;
+  }
+
+  start = std::chrono::steady_clock::now();
+  long sink = 0;
+  for (int i = 0; i < BENCH_IMAGE_LOADS; i++) {
+    Simulator sim(0, 1);
+    sink += sim.load_image(path.c_str());
+    sim.step();
+  }
+  double load = seconds_since(start);
+  remove(path.c_str());
+
+  std::cout << "WarmUp," << fleet_size << ",1," << 1 / warm_up << std::endl;
+  std::cout << "LoadImage," << fleet_size << "," << BENCH_IMAGE_LOADS << ","
+            << (sink ? BENCH_IMAGE_LOADS / load : 0) << std::endl;
+}
+
+/**
+ * @brief Print one line of scenario throughput.
+ */
+static void report_scenario(const char *path, const char *engine,
+                            int vehicles, int ticks, double elapsed) {
+  double vehicle_ticks = (double)ticks * vehicles;
+  std::cout << path << "," << engine << "," << vehicles << "," << ticks << ","
+            << elapsed << "," << vehicle_ticks / elapsed << std::endl;
+}
+
+/**
+ * @brief Run scenario files and report tick throughput, on the state
+ * machine and (where supported) the behavior engine.
+ * @param paths Scenario file paths
+ * @param count Number of paths
+ */
+static int bench_scenarios(char **paths, int count) {
+  std::cout << "Scenario,Engine,Vehicles,Ticks,Seconds,VehicleTicksPerSec"
+            << std::endl;
+
+  for (int i = 0; i < count; i++) {
+    Scenario scenario;
+    if (!load_scenario(paths[i], &scenario)) {
+      return 1;
+    }
+    int vehicles = scenario.config.vehicle_count;
+
+    auto start = std::chrono::steady_clock::now();
+    Simulator sim(scenario.config);
+    sim.simulate(scenario.duration_ms);
+    report_scenario(paths[i], "StateMachine", vehicles, sim.ticks(),
+                    seconds_since(start));
+
+    if (BehaviorEngine::supports(scenario.config)) {
+      start = std::chrono::steady_clock::now();
+      BehaviorEngine engine(scenario.config);
+      engine.simulate(scenario.duration_ms);
+      report_scenario(paths[i], "Behavior", vehicles,
+                      engine.simulator().ticks(), seconds_since(start));
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  // With scenario files given, benchmark those instead
+  if (argc > 1) {
+    return bench_scenarios(argv + 1, argc - 1);
+  }
+
+  std::cout << "Benchmark,FleetSize,Iterations,SimulatorsPerSec" << std::endl;
+
+  for (int fleet_size : BENCH_FLEET_SIZES) {
+    int iterations = (int)(BENCH_TOTAL_VEHICLES / fleet_size);
+
+    std::cout << "ConstructOwned," << fleet_size << "," << iterations << ","
+              << bench_owned(fleet_size, iterations) << std::endl;
+    std::cout << "ConstructArena," << fleet_size << "," << iterations << ","
+              << bench_arena(fleet_size, iterations, false) << std::endl;
+    std::cout << "ConstructArenaHugePages," << fleet_size << "," << iterations
+              << "," << bench_arena(fleet_size, iterations, true) << std::endl;
+  }
+
+  for (int fleet_size : BENCH_WARM_START_FLEET_SIZES) {
+    bench_warm_start(fleet_size);
+  }
+
+  return 0;
+}
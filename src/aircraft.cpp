@@ -12,7 +12,7 @@
 
 #include "aircraft.hpp"
 #include "common.hpp"
-#include <cstdlib>
+#include <cmath>
 
 /*****************************************************************
  *
@@ -26,6 +26,24 @@ const char *aircraft_mode_str[] = {
     "IDLE", "WAIT_CHG", "CHG_DONE", "CHG", "FLY",
 };
 
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Get a freshly initialized aircraft of the given type, to copy from.
+ * @param type The aircraft type
+ *
+ * Prototypes are built once, so creating a fleet is just a copy per aircraft.
+ */
+const Aircraft &aircraft_prototype(AircraftType type) {
+  static const Aircraft prototypes[MAX_AIRCRAFT_TYPES] = {
+      Alpha(), Bravo(), Charlie(), Delta(), Echo(),
+  };
+
+  return prototypes[type];
+}
+
 /*****************************************************************
  * Member function definitions
  *****************************************************************/
@@ -67,15 +85,28 @@ void Aircraft::start_trip(int passengers, double distance) {
 
 /**
  * @class Aircraft
- * @brief Simulate probability of fault occurring.
- * @param duration_ms The duration for which to calculate the fault probability.
+ * @brief Draw the tick of the aircraft's next fault.
+ * @param tick First tick the fault can happen on
+ * @param duration_ms Length of a tick, for the per-tick fault probability
+ * @param rng Random number generator to draw with
+ * @return The tick, or INT_MAX if the aircraft never faults
+ *
+ * Each tick faults independently with the same probability, so the number
+ * of fault-free ticks before the next fault is geometric. One draw gives
+ * the whole gap, instead of one roll per tick.
  */
-void Aircraft::roll_for_fault(double duration_ms) {
+int Aircraft::next_fault_tick(int tick, double duration_ms, Rng &rng) const {
   double fault_prob = (duration_ms / MS_PER_HOUR) * m_p_fault_hourly;
 
-  if ((double)rand() / RAND_MAX < fault_prob) {
-    m_sim_total_num_faults++;
+  if (fault_prob <= 0) {
+    return INT_MAX;
+  } else if (fault_prob >= 1) {
+    return tick;
   }
+
+  double u = (rng.next() + 1.0) / (RNG_MAX + 1.0); // In (0, 1]
+  double gap = std::floor(std::log(u) / std::log1p(-fault_prob));
+  return gap < (double)(INT_MAX - tick) ? tick + (int)gap : INT_MAX;
 }
 
 /**
@@ -84,21 +115,32 @@ void Aircraft::roll_for_fault(double duration_ms) {
  * @param duration_ms The duration for which to update flight parameters.
  */
 void Aircraft::fly(double duration_ms) {
-  double capacity_used = m_energy_use_cruise * m_cruise_speed *
-                         (duration_ms / (double)MS_PER_HOUR);
+  fly(duration_ms, m_cruise_speed, m_energy_use_cruise);
+}
+
+/**
+ * @class Aircraft
+ * @brief Update flight parameters, for a given ground speed and energy use.
+ * @param duration_ms The duration for which to update flight parameters.
+ * @param speed Ground speed (mph)
+ * @param energy_per_mile Energy used per ground mile (kWh/mile)
+ */
+void Aircraft::fly(double duration_ms, double speed, double energy_per_mile) {
+  double capacity_used =
+      energy_per_mile * speed * (duration_ms / (double)MS_PER_HOUR);
 
   if (capacity_used > m_sim_rem_energy) {
     // Not enough battery to run for entire time step
     m_sim_mode = MODE__WAITING_TO_CHARGE;
-    double partial_miles = m_sim_rem_energy / m_energy_use_cruise;
+    m_sim_trips_stranded++;
+    double partial_miles = m_sim_rem_energy / energy_per_mile;
     m_sim_trip_miles_elapsed += partial_miles;
     m_sim_total_miles += partial_miles;
     m_sim_total_passenger_mi += partial_miles * m_sim_trip_passenger_cnt;
     m_sim_rem_energy = 0;
   } else {
     // Enough battery to run for entire time step
-    double miles_traveled =
-        m_cruise_speed * (duration_ms / (double)MS_PER_HOUR);
+    double miles_traveled = speed * (duration_ms / (double)MS_PER_HOUR);
 
     if ((m_sim_trip_miles_elapsed + miles_traveled) >= m_sim_trip_len) {
       m_sim_mode = MODE__IDLE; // Trip complete
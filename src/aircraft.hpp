@@ -10,6 +10,8 @@
  * Includes
  *****************************************************************/
 
+#include "rng.hpp"
+#include <climits>
 #include <cstring>
 
 /*****************************************************************
@@ -46,6 +48,18 @@ extern const char *aircraft_type_str[];
 /** @brief Stringified AircraftMode enum. */
 extern const char *aircraft_mode_str[];
 
+class Aircraft;
+
+/*****************************************************************
+ * Function declarations
+ *****************************************************************/
+
+/**
+ * @brief Get a freshly initialized aircraft of the given type, to copy from.
+ * @param type The aircraft type
+ */
+const Aircraft &aircraft_prototype(AircraftType type);
+
 /*****************************************************************
  * Class definitions
  *****************************************************************/
@@ -61,6 +75,10 @@ extern const char *aircraft_mode_str[];
  * and Simulator class for reporting purposes. Getters/setters would provide
  * better encapsulation but didn't want to write 10000 of them. So they are just
  * public.
+ *
+ * There are no virtual functions (the derived classes only fill in
+ * characteristics), so aircraft are trivially copyable and can be stored by
+ * value in arena memory.
  */
 class Aircraft {
 public:
@@ -83,11 +101,25 @@ public:
   double m_sim_total_miles;             /** Total miles flown (entire sim) */
   double m_sim_total_passenger_mi; /** Passenger miles flown (entire sim) */
   int m_sim_total_num_faults;      /** Total faults (entire sim) */
+  int m_sim_next_fault_tick;       /** Tick of the next fault */
   double m_sim_rem_energy;         /** Remaining battery capacity (kWh) */
   int m_sim_ticks_waiting_chg;     /** Ticks spent waiting to charge (for
                                       FIFO charger allocation) */
   int m_sim_trips_started;         /** Number of trips started */
   int m_sim_charging_sessions;     /** Number of charging sessions */
+  int m_sim_est_arrival_tick;      /** Tick the current trip is expected to
+                                      end (for earliest-arrival allocation
+                                      and reservations) */
+  bool m_sim_charge_booked;        /** Needs a charger at the end of the
+                                      current trip (for reservations) */
+  bool m_sim_charger_held;         /** A charger is held for this aircraft
+                                      until it lands and takes it */
+  int m_sim_trips_stranded;        /** Trips that ran out of battery */
+  int m_sim_trips_deferred;        /** Trips turned down to charge first */
+  int m_sim_region;                /** Vertiport region (for environment
+                                      conditions and airspace limits) */
+  int m_sim_ticks_held;            /** Ticks held on the ground by airspace
+                                      limits */
 
   // Per-trip simulation parameters ----------------------------------------
   double m_sim_trip_len;           /** Trip length (mi) */
@@ -98,6 +130,7 @@ public:
     memset(m_mode_ticks, 0, sizeof(m_mode_ticks));
     m_sim_total_passenger_mi = 0.0;
     m_sim_total_num_faults = 0;
+    m_sim_next_fault_tick = INT_MAX;
     m_sim_trip_len = 0.0;
     m_sim_trip_passenger_cnt = 0;
     m_sim_mode = MODE__IDLE;
@@ -106,10 +139,15 @@ public:
     m_sim_trips_started = 0;
     m_sim_total_miles = 0.0;
     m_sim_charging_sessions = 0;
+    m_sim_est_arrival_tick = 0;
+    m_sim_charge_booked = false;
+    m_sim_charger_held = false;
+    m_sim_trips_stranded = 0;
+    m_sim_trips_deferred = 0;
+    m_sim_region = 0;
+    m_sim_ticks_held = 0;
   };
 
-  virtual ~Aircraft() = default;
-
   /**
    * @class Aircraft
    * @brief Initialize a trip.
@@ -127,11 +165,22 @@ public:
 
   /**
    * @class Aircraft
-   * @brief Simulate probability of fault occurring.
-   * @param duration_ms The duration for which to calculate the fault
-   * probability.
+   * @brief Update flight parameters, for a given ground speed and energy use.
+   * @param duration_ms The duration for which to update flight parameters.
+   * @param speed Ground speed (mph)
+   * @param energy_per_mile Energy used per ground mile (kWh/mile)
+   */
+  void fly(double duration_ms, double speed, double energy_per_mile);
+
+  /**
+   * @class Aircraft
+   * @brief Draw the tick of the aircraft's next fault.
+   * @param tick First tick the fault can happen on
+   * @param duration_ms Length of a tick, for the per-tick fault probability
+   * @param rng Random number generator to draw with
+   * @return The tick, or INT_MAX if the aircraft never faults
    */
-  void roll_for_fault(double duration_ms);
+  int next_fault_tick(int tick, double duration_ms, Rng &rng) const;
 
   /**
    * @class Aircraft
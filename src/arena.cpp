@@ -0,0 +1,150 @@
+/**
+ * @file arena.cpp
+ * @brief Arena class implementation.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "arena.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+/*****************************************************************
+ * Member function definitions
+ *****************************************************************/
+
+/**
+ * @class Arena
+ * @brief Constructor for arena.
+ * @param capacity Size of the block to reserve (bytes)
+ * @param huge_pages Try to place the block on huge pages
+ *
+ * Explicit huge pages (MAP_HUGETLB) are tried first. If none are reserved on
+ * the system, fall back to regular pages and ask for transparent huge pages
+ * instead. Either way, huge_pages() reports whether explicit huge pages were
+ * actually used.
+ */
+Arena::Arena(size_t capacity, bool huge_pages) {
+  if (capacity == 0) {
+    return;
+  }
+
+  if (huge_pages) {
+    capacity = (capacity + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    void *block = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (block != MAP_FAILED) {
+      m_huge_pages = true;
+    } else {
+      block = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (block == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      madvise(block, capacity, MADV_HUGEPAGE);
+    }
+
+    m_base = (char *)block;
+    m_mapped = true;
+  } else {
+    m_base = (char *)malloc(capacity);
+    if (!m_base) {
+      throw std::bad_alloc();
+    }
+  }
+
+  m_capacity = capacity;
+}
+
+Arena::~Arena() { release(); }
+
+Arena::Arena(Arena &&other) noexcept { *this = static_cast<Arena &&>(other); }
+
+Arena &Arena::operator=(Arena &&other) noexcept {
+  if (this != &other) {
+    release();
+    m_base = other.m_base;
+    m_capacity = other.m_capacity;
+    m_used = other.m_used;
+    m_mapped = other.m_mapped;
+    m_huge_pages = other.m_huge_pages;
+    other.m_base = nullptr;
+    other.m_capacity = 0;
+    other.m_used = 0;
+  }
+  return *this;
+}
+
+/**
+ * @class Arena
+ * @brief Allocate uninitialized memory from the arena.
+ * @param bytes Number of bytes to allocate
+ * @param align Alignment of the allocation (power of 2)
+ * @throws std::bad_alloc if the arena doesn't have enough space left
+ */
+void *Arena::allocate(size_t bytes, size_t align) {
+  uintptr_t start = ((uintptr_t)m_base + m_used + align - 1) & ~(align - 1);
+  size_t end = (start - (uintptr_t)m_base) + bytes;
+
+  if (end > m_capacity) {
+    throw std::bad_alloc();
+  }
+
+  m_used = end;
+  return (void *)start;
+}
+
+/**
+ * @class Arena
+ * @brief Replace the arena's block with a copy-on-write mapping of part of
+ * a file, all of it already allocated.
+ * @param fd Open file
+ * @param offset Start of the mapping in the file (page aligned)
+ * @param bytes Size of the mapping
+ * @return false if the file couldn't be mapped
+ *
+ * Pages are read in from the file on first touch, and writes go to private
+ * copies, so the file itself is never modified.
+ */
+bool Arena::map_file(int fd, size_t offset, size_t bytes) {
+  void *block = nullptr;
+
+  if (bytes > 0) {
+    block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                 (off_t)offset);
+    if (block == MAP_FAILED) {
+      return false;
+    }
+  }
+
+  release();
+  m_base = (char *)block;
+  m_capacity = bytes;
+  m_used = bytes;
+  m_mapped = true;
+  m_huge_pages = false;
+  return true;
+}
+
+/**
+ * @class Arena
+ * @brief Return the block to the system.
+ */
+void Arena::release() {
+  if (!m_base) {
+    return;
+  }
+
+  if (m_mapped) {
+    munmap(m_base, m_capacity);
+  } else {
+    free(m_base);
+  }
+
+  m_base = nullptr;
+}
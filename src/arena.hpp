@@ -0,0 +1,113 @@
+/**
+ * @file arena.hpp
+ * @brief Arena class definition.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include <cstddef>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Default alignment for arena allocations. */
+constexpr size_t ARENA_ALIGN = alignof(std::max_align_t);
+
+/** @brief Size of a huge page (x86-64 Linux default). */
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/*****************************************************************
+ * Class definitions
+ *****************************************************************/
+
+/**
+ * @class Arena
+ * @brief Bump allocator over one contiguous block of memory.
+ *
+ * Everything a simulation run needs (fleet, scratch buffers) is carved out of
+ * a single block, and reset() frees all of it at once by rewinding the bump
+ * pointer. Nothing is destructed on reset, so only trivially destructible
+ * objects should live in an arena.
+ *
+ * The block can optionally be placed on huge pages, which cuts TLB misses
+ * when iterating over very large fleets.
+ */
+class Arena {
+public:
+  Arena() = default;
+  Arena(size_t capacity, bool huge_pages = false);
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  Arena(Arena &&other) noexcept;
+  Arena &operator=(Arena &&other) noexcept;
+
+  /**
+   * @class Arena
+   * @brief Allocate uninitialized memory from the arena.
+   * @param bytes Number of bytes to allocate
+   * @param align Alignment of the allocation (power of 2)
+   * @throws std::bad_alloc if the arena doesn't have enough space left
+   */
+  void *allocate(size_t bytes, size_t align = ARENA_ALIGN);
+
+  /**
+   * @class Arena
+   * @brief Allocate uninitialized memory for an array of objects.
+   * @param count Number of objects
+   */
+  template <typename T> T *allocate_array(size_t count) {
+    return (T *)allocate(count * sizeof(T), alignof(T));
+  }
+
+  /**
+   * @class Arena
+   * @brief Replace the arena's block with a copy-on-write mapping of part of
+   * a file, all of it already allocated.
+   * @param fd Open file
+   * @param offset Start of the mapping in the file (page aligned)
+   * @param bytes Size of the mapping
+   * @return false if the file couldn't be mapped
+   */
+  bool map_file(int fd, size_t offset, size_t bytes);
+
+  /** @brief Start of the block. */
+  void *base() const { return m_base; }
+
+  /**
+   * @class Arena
+   * @brief Free everything allocated from the arena, in O(1).
+   */
+  void reset() { m_used = 0; }
+
+  /** @brief Bytes currently allocated. */
+  size_t used() const { return m_used; }
+
+  /** @brief Total bytes available. */
+  size_t capacity() const { return m_capacity; }
+
+  /** @brief Whether the block was actually placed on huge pages. */
+  bool huge_pages() const { return m_huge_pages; }
+
+private:
+  char *m_base = nullptr;    /** Start of the block */
+  size_t m_capacity = 0;     /** Size of the block (bytes) */
+  size_t m_used = 0;         /** Bump pointer offset (bytes) */
+  bool m_mapped = false;     /** Block came from mmap rather than malloc */
+  bool m_huge_pages = false; /** Block is backed by huge pages */
+
+  /**
+   * @class Arena
+   * @brief Return the block to the system.
+   */
+  void release();
+};
+
+#endif /* ARENA_H */
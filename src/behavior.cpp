@@ -0,0 +1,553 @@
+/**
+ * @file behavior.cpp
+ * @brief Coroutine behavior scripts and the BehaviorEngine that runs them.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "behavior.hpp"
+#include "common.hpp"
+#include "state_hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Space before each frame for the pool that owns it. */
+constexpr size_t FRAME_HEADER_BYTES = ARENA_ALIGN;
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief The built-in behavior: exactly the Simulator state machine.
+ * @param engine The engine running the script
+ * @param index Index of the aircraft in the fleet
+ */
+Behavior default_behavior(BehaviorEngine &engine, int index) {
+  while (true) {
+    if (engine.dispatch_trip(index)) {
+      bool landed = co_await engine.fly(index);
+      if (landed) {
+        co_await engine.next_tick(index);
+        continue;
+      }
+    }
+
+    co_await engine.charge(index);
+    co_await engine.next_tick(index);
+  }
+}
+
+/**
+ * @brief Allocate a coroutine frame from the engine's frame pool.
+ */
+void *Behavior::promise_type::operator new(size_t bytes, BehaviorEngine &engine,
+                                           int) {
+  return engine.frame_pool().allocate(bytes);
+}
+
+/*****************************************************************
+ * Member function definitions
+ *****************************************************************/
+
+/**
+ * @class FramePool
+ * @brief Allocate memory for a coroutine frame.
+ * @param bytes Size of the frame
+ */
+void *FramePool::allocate(size_t bytes) {
+  size_t block_bytes = bytes + FRAME_HEADER_BYTES;
+  char *block;
+
+  if (!m_frame_bytes) {
+    m_frame_bytes = bytes;
+  }
+
+  if (bytes == m_frame_bytes && m_free) {
+    block = (char *)m_free;
+    m_free = *(void **)m_free;
+  } else {
+    if (m_chunks.empty() || m_chunks.back().capacity() -
+                                    m_chunks.back().used() <
+                                block_bytes + ARENA_ALIGN) {
+      m_chunks.emplace_back(
+          std::max(FRAME_POOL_CHUNK_BYTES, block_bytes + ARENA_ALIGN));
+    }
+    block = (char *)m_chunks.back().allocate(block_bytes);
+  }
+
+  *(FramePool **)block = this;
+  return block + FRAME_HEADER_BYTES;
+}
+
+/**
+ * @class FramePool
+ * @brief Return a frame to the pool that allocated it.
+ * @param frame The frame
+ * @param bytes Size of the frame
+ */
+void FramePool::deallocate(void *frame, size_t bytes) {
+  char *block = (char *)frame - FRAME_HEADER_BYTES;
+  FramePool *pool = *(FramePool **)block;
+
+  if (bytes == pool->m_frame_bytes) {
+    *(void **)block = pool->m_free;
+    pool->m_free = block;
+  }
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Constructor for the engine.
+ * @param config Fleet, chargers, time step, seed and policies. The fleet is
+ * built exactly as Simulator builds it.
+ */
+BehaviorEngine::BehaviorEngine(const SimulatorConfig &config)
+    : m_sim(config), m_vehicles(m_sim.m_vehicles) {
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    m_scripts[i] = default_behavior;
+  }
+
+  int vehicle_count = m_sim.m_vehicle_count;
+  m_tracks.resize(vehicle_count);
+  m_faults.assign(vehicle_count, 0);
+
+  // The Simulator has drawn each aircraft's first fault
+  for (int i = 0; i < vehicle_count; i++) {
+    m_fault_queue.push(Wakeup(m_vehicles[i].m_sim_next_fault_tick, i));
+  }
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Destructor. The scripts' frames go back to the pool before it goes.
+ */
+BehaviorEngine::~BehaviorEngine() { m_behaviors.clear(); }
+
+/**
+ * @class BehaviorEngine
+ * @brief Check whether a configuration can run on the engine.
+ * @param config The configuration
+ */
+bool BehaviorEngine::supports(const SimulatorConfig &config) {
+  return !config.environment &&
+         POLICY__RESERVATION != config.charger_policy;
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Use a custom script for one aircraft type. Call before simulate().
+ * @param type The aircraft type
+ * @param script The script
+ */
+void BehaviorEngine::set_behavior(AircraftType type, BehaviorScript script) {
+  m_scripts[type] = script;
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Run a complete simulation.
+ * @param duration_ms Sim time, in milliseconds
+ */
+void BehaviorEngine::simulate(long long duration_ms) {
+  if (m_started) {
+    std::cerr << "BehaviorEngine::simulate() can only be called once"
+              << std::endl;
+    return;
+  }
+  m_started = true;
+
+  int vehicle_count = m_sim.m_vehicle_count;
+  m_behaviors.reserve(vehicle_count);
+
+  for (int i = 0; i < vehicle_count; i++) {
+    m_behaviors.push_back(m_scripts[m_vehicles[i].m_type](*this, i));
+    wake_at(0, i);
+  }
+
+  if (m_hash_trace) {
+    m_vehicle_hashes = m_sim.m_arena->allocate_array<uint64_t>(vehicle_count);
+    memset(m_vehicle_hashes, 0, vehicle_count * sizeof(uint64_t));
+    for (int i = 0; i < vehicle_count; i++) {
+      rehash(i);
+    }
+  }
+
+  for (long long time = 0; time < duration_ms; time += m_sim.m_step_ms) {
+    step();
+  }
+
+  finish();
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Queue a wake-up for an aircraft.
+ */
+void BehaviorEngine::wake_at(int tick, int index) {
+  m_wakeup_queue.push(Wakeup(tick, index));
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Run one tick.
+ *
+ * The aircraft with a fault due this tick draw their next one, in fleet
+ * order, as in Simulator. Then the aircraft with a wake-up due this tick are
+ * handled, also in fleet order; everything else is mid-phase and left alone.
+ */
+void BehaviorEngine::step() {
+  m_sim.m_ticks = m_tick;
+
+  while (!m_fault_queue.empty() && m_fault_queue.top().first == m_tick) {
+    int index = m_fault_queue.top().second;
+    m_fault_queue.pop();
+
+    Aircraft *vehicle = &m_vehicles[index];
+    vehicle->m_sim_next_fault_tick =
+        vehicle->next_fault_tick(m_tick + 1, m_sim.m_step_ms, m_sim.m_rng);
+    m_fault_queue.push(Wakeup(vehicle->m_sim_next_fault_tick, index));
+    m_faults[index]++;
+    rehash(index);
+  }
+
+  while (!m_wakeup_queue.empty() && m_wakeup_queue.top().first == m_tick) {
+    int index = m_wakeup_queue.top().second;
+    m_wakeup_queue.pop();
+    m_wakeups++;
+
+    Track *track = &m_tracks[index];
+    Aircraft *vehicle = &m_vehicles[index];
+    track->tick = m_tick;
+
+    if (WAKE__TRY_CHARGER == track->action) {
+      if (track->allocated) {
+        begin_charge(index);
+      } else if (m_sim.m_num_chargers_in_use < m_sim.m_charger_count) {
+        m_waiting.erase({track->wait_key, index});
+        take_charger(index, m_tick + 1);
+        begin_charge(index);
+      } else {
+        track->awaiting_allocation = true;
+      }
+      continue;
+    }
+
+    if (WAKE__CHARGED == track->action) {
+      vehicle->m_sim_mode = track->phase_end_mode;
+      rehash(index);
+      track->action = WAKE__CHARGE_DONE;
+      wake_at(m_tick + 1, index);
+      continue;
+    }
+
+    if (track->in_phase) {
+      track->in_phase = false;
+      set_mode(index, track->phase_end_mode, track->phase_end + 1);
+      vehicle->m_sim_mode = track->phase_end_mode;
+      rehash(index);
+    }
+
+    if (WAKE__CHARGE_DONE == track->action) {
+      m_sim.m_num_chargers_in_use--;
+      set_mode(index, MODE__IDLE, m_tick + 1);
+      vehicle->m_sim_mode = MODE__IDLE;
+      rehash(index);
+      allocate_charger(index);
+      track->action = WAKE__RESUME;
+    }
+
+    m_behaviors[index].resume();
+  }
+
+  if (m_hash_trace) {
+    m_hash_trace->push_back(m_state_hash);
+  }
+
+  m_tick++;
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Update the state hash after an aircraft's mode or counts change.
+ */
+void BehaviorEngine::rehash(int index) {
+  if (!m_hash_trace) {
+    return;
+  }
+
+  const Aircraft *vehicle = &m_vehicles[index];
+  uint64_t hash = vehicle_state_hash(
+      index, vehicle->m_sim_mode, vehicle->m_sim_trips_started,
+      vehicle->m_sim_charging_sessions, m_faults[index]);
+
+  m_state_hash += hash - m_vehicle_hashes[index];
+  m_vehicle_hashes[index] = hash;
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Change an aircraft's mode, accounting time spent in the old one.
+ * @param mode The new mode
+ * @param first_tick First tick spent in the new mode
+ */
+void BehaviorEngine::set_mode(int index, AircraftMode mode, int first_tick) {
+  Track *track = &m_tracks[index];
+
+  m_vehicles[index].m_mode_ticks[track->mode] +=
+      first_tick - track->mode_start;
+  track->mode = mode;
+  track->mode_start = first_tick;
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Send an idle aircraft on a trip, or to wait for a charger if its
+ * battery is flat or (with range prediction) too low.
+ * @param index Index of the aircraft
+ * @return true if a trip was started, false if it now needs charging
+ */
+bool BehaviorEngine::dispatch_trip(int index) {
+  Aircraft *vehicle = &m_vehicles[index];
+
+  if (vehicle->m_sim_rem_energy <= 0) {
+    vehicle->m_sim_mode = MODE__WAITING_TO_CHARGE;
+  } else {
+    m_sim.dispatch_trip(vehicle);
+  }
+
+  set_mode(index, vehicle->m_sim_mode, m_tick + 1);
+  rehash(index);
+  return MODE__FLYING == vehicle->m_sim_mode;
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Fly the trip started by dispatch_trip() to its end.
+ * @return Awaitable: true if the trip was completed, false if the battery
+ * ran out (the aircraft is then waiting for a charger)
+ *
+ * The whole flight is worked out now, a tick at a time exactly as
+ * Simulator would, and the aircraft shows as flying until the last tick.
+ */
+BehaviorEngine::Wait BehaviorEngine::fly(int index) {
+  Track *track = &m_tracks[index];
+  Aircraft *vehicle = &m_vehicles[index];
+
+  set_mode(index, MODE__FLYING, m_tick + 1);
+  track->before = *vehicle;
+
+  int ticks = 0;
+  do {
+    vehicle->fly(m_sim.m_step_ms);
+    ticks++;
+  } while (MODE__FLYING == vehicle->m_sim_mode);
+
+  track->in_phase = true;
+  track->phase_start = m_tick + 1;
+  track->phase_end = m_tick + ticks;
+  track->phase_mode = MODE__FLYING;
+  track->phase_end_mode = vehicle->m_sim_mode;
+  vehicle->m_sim_mode = MODE__FLYING;
+
+  return {this, index, track->phase_end, MODE__IDLE == track->phase_end_mode};
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Queue for a charger, charge to full, and give the charger up.
+ * @return Awaitable, resuming at the tick the charger is given up. The
+ * aircraft is idle from the next tick.
+ */
+BehaviorEngine::Wait BehaviorEngine::charge(int index) {
+  begin_wait(index);
+  return {this, index, -1, true};
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Start waiting for a charger at the current tick.
+ *
+ * The aircraft first looks for a free charger next tick, as in Simulator.
+ * After that it can only get one when another aircraft gives one up.
+ */
+void BehaviorEngine::begin_wait(int index) {
+  Track *track = &m_tracks[index];
+  Aircraft *vehicle = &m_vehicles[index];
+
+  set_mode(index, MODE__WAITING_TO_CHARGE, m_tick + 1);
+  vehicle->m_sim_mode = MODE__WAITING_TO_CHARGE;
+  track->wait_start = m_tick;
+
+  // Everything the policies compare is fixed while an aircraft waits, except
+  // FIFO's wait time, which allocate_charger() derives from the start tick
+  switch (m_sim.m_charger_policy) {
+  case POLICY__LOWEST_ENERGY:
+    track->wait_key = vehicle->m_sim_rem_energy;
+    break;
+  case POLICY__SHORTEST_CHARGE:
+    track->wait_key =
+        vehicle->m_charge_time *
+        (1 - vehicle->m_sim_rem_energy / vehicle->m_max_battery_cap);
+    break;
+  case POLICY__EARLIEST_ARRIVAL:
+    track->wait_key = vehicle->m_sim_est_arrival_tick;
+    break;
+  default:
+    track->wait_key = m_tick;
+    break;
+  }
+
+  m_waiting.insert({track->wait_key, index});
+  rehash(index);
+  track->action = WAKE__TRY_CHARGER;
+  wake_at(m_tick + 1, index);
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Take a charger for a waiting aircraft.
+ * @param first_tick First tick the aircraft charges
+ */
+void BehaviorEngine::take_charger(int index, int first_tick) {
+  Aircraft *vehicle = &m_vehicles[index];
+
+  m_sim.m_num_chargers_in_use++;
+  vehicle->m_sim_charging_sessions++;
+  vehicle->m_sim_ticks_waiting_chg = 0;
+  vehicle->m_sim_mode = MODE__CHARGING;
+  set_mode(index, MODE__CHARGING, first_tick);
+  m_tracks[index].charge_start = first_tick;
+  rehash(index);
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Charge a waiting aircraft that just got a charger to full.
+ *
+ * Like fly(), the whole charge is worked out now, and the aircraft shows as
+ * charging until the last tick.
+ */
+void BehaviorEngine::begin_charge(int index) {
+  Track *track = &m_tracks[index];
+  Aircraft *vehicle = &m_vehicles[index];
+
+  track->awaiting_allocation = false;
+  track->allocated = false;
+  track->before = *vehicle;
+
+  int ticks = 0;
+  do {
+    vehicle->charge(m_sim.m_step_ms);
+    ticks++;
+  } while (MODE__CHARGING == vehicle->m_sim_mode);
+
+  track->in_phase = true;
+  track->phase_start = track->charge_start;
+  track->phase_end = track->charge_start + ticks - 1;
+  track->phase_mode = MODE__CHARGING;
+  track->phase_end_mode = vehicle->m_sim_mode;
+  vehicle->m_sim_mode = MODE__CHARGING;
+
+  // Simulator shows the charge complete a tick before giving the charger up.
+  // Only the state hash can see that, but the schedule is the same whether
+  // hashing or not, so traces check the schedule normal runs use.
+  track->action = WAKE__CHARGED;
+  wake_at(track->phase_end, index);
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Hand a free charger to the waiting aircraft the charger policy
+ * picks, as the aircraft at `index` gives it up.
+ *
+ * FIFO picks the longest wait, ties to the lowest index. An aircraft that
+ * started waiting at tick t0 has waited t - t0 - 1 ticks at tick t, plus one
+ * if it has already been updated this tick (it comes before `index`). So
+ * the longest wait is among the earliest starters, unless none of those come
+ * before `index` and one of the next earliest does.
+ */
+void BehaviorEngine::allocate_charger(int index) {
+  if (m_sim.m_num_chargers_in_use >= m_sim.m_charger_count ||
+      m_waiting.empty()) {
+    return;
+  }
+
+  auto pick = m_waiting.begin();
+
+  if (POLICY__FIFO == m_sim.m_charger_policy && pick->second > index) {
+    auto next = m_waiting.lower_bound({pick->first + 1, -1});
+    if (next != m_waiting.end() && next->first == pick->first + 1 &&
+        next->second < index) {
+      pick = next;
+    }
+  }
+
+  int next_index = pick->second;
+  m_waiting.erase(pick);
+
+  // Aircraft after `index` still get updated (and so charge) this tick
+  take_charger(next_index, m_tick + (next_index > index ? 0 : 1));
+
+  Track *track = &m_tracks[next_index];
+  if (track->awaiting_allocation) {
+    begin_charge(next_index);
+  } else {
+    track->allocated = true; // Charging starts at its first look
+  }
+}
+
+/**
+ * @class BehaviorEngine
+ * @brief Bring the fleet up to date with the current tick, finishing
+ * partial phases.
+ *
+ * Phases still in progress are rolled back and replayed up to the current
+ * tick only, so the fleet ends up exactly as Simulator would leave it.
+ */
+void BehaviorEngine::finish() {
+  int waiting = 0;
+
+  for (int i = 0; i < m_sim.m_vehicle_count; i++) {
+    Track *track = &m_tracks[i];
+    Aircraft *vehicle = &m_vehicles[i];
+
+    if (track->in_phase && track->phase_end >= m_tick) {
+      // Faults are kept apart from the phase being rolled back
+      int next_fault_tick = vehicle->m_sim_next_fault_tick;
+      *vehicle = track->before;
+      vehicle->m_sim_next_fault_tick = next_fault_tick;
+      for (int tick = track->phase_start; tick < m_tick; tick++) {
+        if (MODE__FLYING == track->phase_mode) {
+          vehicle->fly(m_sim.m_step_ms);
+        } else {
+          vehicle->charge(m_sim.m_step_ms);
+        }
+      }
+    } else if (track->in_phase) {
+      set_mode(i, track->phase_end_mode, track->phase_end + 1);
+      vehicle->m_sim_mode = track->phase_end_mode;
+    }
+    track->in_phase = false;
+
+    set_mode(i, track->mode, m_tick);
+
+    if (MODE__WAITING_TO_CHARGE == track->mode) {
+      vehicle->m_sim_ticks_waiting_chg = m_tick - track->wait_start - 1;
+    }
+
+    vehicle->m_sim_total_num_faults += m_faults[i];
+    m_faults[i] = 0;
+    waiting += (MODE__WAITING_TO_CHARGE == vehicle->m_sim_mode);
+  }
+
+  m_sim.m_ticks = m_tick;
+  m_sim.m_num_waiting = waiting;
+}
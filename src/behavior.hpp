@@ -0,0 +1,431 @@
+/**
+ * @file behavior.hpp
+ * @brief Coroutine behavior scripts and the BehaviorEngine that runs them.
+ */
+
+#ifndef BEHAVIOR_H
+#define BEHAVIOR_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "aircraft.hpp"
+#include "arena.hpp"
+#include "simulator.hpp"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <set>
+#include <utility>
+#include <vector>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Size of each block of memory the frame pool carves frames from. */
+constexpr size_t FRAME_POOL_CHUNK_BYTES = 1024 * 1024;
+
+/*****************************************************************
+ * Class definitions
+ *****************************************************************/
+
+class BehaviorEngine;
+
+/**
+ * @class FramePool
+ * @brief Recycling allocator for coroutine frames.
+ *
+ * Frames are carved out of arena chunks and recycled through a free list, so
+ * starting a script never touches the system allocator once the pool is warm.
+ * Only frames of the most common size (the first one seen) are recycled;
+ * others are reclaimed when the pool is destroyed.
+ */
+class FramePool {
+public:
+  FramePool() = default;
+
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  /**
+   * @class FramePool
+   * @brief Allocate memory for a coroutine frame.
+   * @param bytes Size of the frame
+   */
+  void *allocate(size_t bytes);
+
+  /**
+   * @class FramePool
+   * @brief Return a frame to the pool that allocated it.
+   * @param frame The frame
+   * @param bytes Size of the frame
+   */
+  static void deallocate(void *frame, size_t bytes);
+
+  /** @brief Number of arena chunks allocated. */
+  size_t chunks() const { return m_chunks.size(); }
+
+private:
+  std::vector<Arena> m_chunks; /** Memory frames are carved from */
+  void *m_free = nullptr;      /** Free list of recycled frames */
+  size_t m_frame_bytes = 0;    /** Size of recycled frames */
+};
+
+/**
+ * @class Behavior
+ * @brief A running behavior script: the coroutine driving one aircraft.
+ *
+ * Scripts are coroutines with the signature of BehaviorScript. They start
+ * suspended, and the BehaviorEngine resumes them at the ticks they ask to
+ * be woken at. Their frames come from the engine's FramePool.
+ */
+class Behavior {
+public:
+  struct promise_type {
+    Behavior get_return_object() {
+      return Behavior(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { throw; }
+
+    /** Frames are allocated from the engine running the script */
+    static void *operator new(size_t bytes, BehaviorEngine &engine, int index);
+    static void operator delete(void *frame, size_t bytes) {
+      FramePool::deallocate(frame, bytes);
+    }
+  };
+
+  Behavior() = default;
+  Behavior(Behavior &&other) noexcept
+      : m_handle(std::exchange(other.m_handle, nullptr)) {}
+  Behavior &operator=(Behavior &&other) noexcept {
+    std::swap(m_handle, other.m_handle);
+    return *this;
+  }
+  ~Behavior() {
+    if (m_handle) {
+      m_handle.destroy();
+    }
+  }
+
+  /**
+   * @class Behavior
+   * @brief Run the script until it next suspends.
+   */
+  void resume() {
+    if (m_handle && !m_handle.done()) {
+      m_handle.resume();
+    }
+  }
+
+private:
+  explicit Behavior(std::coroutine_handle<promise_type> handle)
+      : m_handle(handle) {}
+
+  std::coroutine_handle<promise_type> m_handle; /** The coroutine */
+};
+
+/**
+ * @brief A behavior script: a coroutine that drives one aircraft.
+ * @param engine The engine running the script
+ * @param index Index of the aircraft in the fleet
+ */
+using BehaviorScript = Behavior (*)(BehaviorEngine &engine, int index);
+
+/**
+ * @brief The built-in behavior: exactly the Simulator state machine.
+ *
+ * Fly a trip whenever idle; wait for a charger and charge when the battery
+ * is flat, or (with range prediction) too low for the next trip.
+ */
+Behavior default_behavior(BehaviorEngine &engine, int index);
+
+/**
+ * @class BehaviorEngine
+ * @brief Runs a fleet with per-type behavior scripts instead of the
+ * Simulator's per-tick state machine.
+ *
+ * Each aircraft is driven by a coroutine. Flights and charges are long,
+ * predictable stretches, so the script asks for one whole phase at a time:
+ * the engine works out when the phase ends, by running the same per-tick
+ * arithmetic as Aircraft::fly() and Aircraft::charge() up front, and only
+ * wakes the script at that tick. Each tick, only aircraft with a wake-up due
+ * are touched, in fleet order, from a (tick, index) priority queue.
+ *
+ * Faults are wake-ups too. Each aircraft draws the tick of its next fault
+ * (Aircraft::next_fault_tick()), and a second (tick, index) queue holds
+ * them, so a tick only touches the aircraft faulting in it. The Simulator
+ * draws at the same ticks in the same fleet order, so both stay on the
+ * same random number stream.
+ *
+ * Charger allocation follows the Simulator's exactly, including which
+ * aircraft win within a tick, so with default_behavior() the results match
+ * Simulator for every charger policy but Reservation, with or without range
+ * prediction.
+ *
+ * The engine is a friend of Simulator and works on its internals directly:
+ * it owns a Simulator for the fleet, chargers, random numbers and reports,
+ * runs its own tick loop over them, and reuses Simulator::dispatch_trip().
+ * Changes to the Simulator's state machine need matching changes here.
+ * Environments (weather and airspace limits) are not supported, since
+ * phases are worked out up front at cruise speed; supports() turns them
+ * away. So does the Reservation policy, which holds chargers for aircraft
+ * mid-flight and would need to change how their trips end. Deferred
+ * allocation and fleet images aren't supported either.
+ *
+ * An engine runs once: simulate() leaves the fleet holding the final state,
+ * ready for the Simulator reports via simulator(). Calling it again prints
+ * an error and does nothing.
+ */
+class BehaviorEngine {
+public:
+  BehaviorEngine(const SimulatorConfig &config);
+  ~BehaviorEngine();
+
+  BehaviorEngine(const BehaviorEngine &) = delete;
+  BehaviorEngine &operator=(const BehaviorEngine &) = delete;
+
+  /**
+   * @class BehaviorEngine
+   * @brief Check whether a configuration can run on the engine.
+   * @param config The configuration
+   */
+  static bool supports(const SimulatorConfig &config);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Use a custom script for one aircraft type. Call before simulate().
+   * @param type The aircraft type
+   * @param script The script
+   */
+  void set_behavior(AircraftType type, BehaviorScript script);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Run a complete simulation.
+   * @param duration_ms Sim time, in milliseconds
+   */
+  void simulate(long long duration_ms);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Record the fleet state hash at the end of every tick, exactly as
+   * Simulator::set_hash_trace() does. Call before simulate().
+   * @param trace Vector to append a hash per tick to, or nullptr
+   */
+  void set_hash_trace(std::vector<uint64_t> *trace) { m_hash_trace = trace; }
+
+  /**
+   * @class BehaviorEngine
+   * @brief The simulator holding the fleet, for reports.
+   */
+  Simulator &simulator() { return m_sim; }
+
+  /**
+   * @class BehaviorEngine
+   * @brief Frame pool the scripts' coroutine frames come from.
+   */
+  FramePool &frame_pool() { return m_frame_pool; }
+
+  /**
+   * @class BehaviorEngine
+   * @brief Number of times a script was woken up.
+   */
+  long long wakeups() const { return m_wakeups; }
+
+  // Script primitives ---------------------------------------------------
+
+  /** @brief Awaitable returned by the script primitives. */
+  struct Wait {
+    BehaviorEngine *engine;
+    int index;
+    int tick; /** Tick to wake the script at, or -1 if the engine will */
+    bool result;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<>) const {
+      if (tick >= 0) {
+        engine->wake_at(tick, index);
+      }
+    }
+    bool await_resume() const noexcept { return result; }
+  };
+
+  /**
+   * @class BehaviorEngine
+   * @brief Current tick, as seen by the running script.
+   */
+  int tick() const { return m_tick; }
+
+  /**
+   * @class BehaviorEngine
+   * @brief The aircraft a script drives.
+   * @param index Index of the aircraft in the fleet
+   */
+  Aircraft &vehicle(int index) { return m_vehicles[index]; }
+
+  /**
+   * @class BehaviorEngine
+   * @brief Send an idle aircraft on a trip, or to wait for a charger if its
+   * battery is flat or (with range prediction) too low.
+   * @param index Index of the aircraft
+   * @return true if a trip was started, false if it now needs charging
+   */
+  bool dispatch_trip(int index);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Stay in the current mode until the next tick.
+   */
+  Wait next_tick(int index) {
+    return {this, index, m_tracks[index].tick + 1, true};
+  }
+
+  /**
+   * @class BehaviorEngine
+   * @brief Stay in the current mode (loiter) for a number of ticks.
+   * @param ticks Ticks to wait, at least 1
+   */
+  Wait hold(int index, int ticks) {
+    return {this, index, m_tracks[index].tick + (ticks > 0 ? ticks : 1),
+            true};
+  }
+
+  /**
+   * @class BehaviorEngine
+   * @brief Fly the trip started by dispatch_trip() to its end.
+   * @return Awaitable: true if the trip was completed, false if the battery
+   * ran out (the aircraft is then waiting for a charger)
+   */
+  Wait fly(int index);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Queue for a charger, charge to full, and give the charger up.
+   * @return Awaitable, resuming at the tick the charger is given up. The
+   * aircraft is idle from the next tick.
+   */
+  Wait charge(int index);
+
+private:
+  /** @brief What the engine does at an aircraft's next wake-up. */
+  enum WakeAction {
+    WAKE__RESUME,      /** Resume the script */
+    WAKE__TRY_CHARGER, /** First look for a free charger */
+    WAKE__CHARGED,     /** Show the charge as complete */
+    WAKE__CHARGE_DONE, /** Give the charger up, then resume the script */
+  };
+
+  /** @brief Engine-side state for one aircraft. */
+  struct Track {
+    int tick = 0;                    /** Tick of the latest wake-up */
+    WakeAction action = WAKE__RESUME; /** What the next wake-up does */
+    AircraftMode mode = MODE__IDLE;  /** Mode for accounting */
+    int mode_start = 0;              /** First tick spent in `mode` */
+    int wait_start = 0;              /** Tick the aircraft started waiting */
+    double wait_key = 0;             /** Charger policy key while waiting */
+    bool awaiting_allocation = false; /** Waiting for a charger to free up */
+    bool allocated = false;          /** Given a charger before its first
+                                        look for one */
+    int charge_start = 0;            /** First tick of charging */
+
+    // Flight or charge worked out up front --------------------------------
+    bool in_phase = false;           /** A phase is in progress */
+    int phase_start = 0;             /** First tick of the phase */
+    int phase_end = 0;               /** Last tick of the phase */
+    AircraftMode phase_mode = MODE__IDLE;     /** Mode during the phase */
+    AircraftMode phase_end_mode = MODE__IDLE; /** Mode after the phase */
+    Aircraft before;                 /** Aircraft before the phase */
+  };
+
+  /** @brief A wake-up, ordered by tick and then fleet order. */
+  using Wakeup = std::pair<int, int>;
+
+  Simulator m_sim;                  /** Fleet, chargers and random numbers */
+  Aircraft *m_vehicles;             /** m_sim's fleet */
+  int m_tick = 0;                   /** Current tick */
+  long long m_wakeups = 0;          /** Script wake-ups so far */
+  FramePool m_frame_pool;           /** Memory for coroutine frames */
+  BehaviorScript m_scripts[MAX_AIRCRAFT_TYPES]; /** Script per type */
+  std::vector<Behavior> m_behaviors; /** Running script per aircraft */
+  std::vector<Track> m_tracks;      /** Engine state per aircraft */
+  std::vector<int> m_faults;        /** Faults per aircraft */
+  std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup>>
+      m_wakeup_queue;               /** Pending wake-ups */
+  std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup>>
+      m_fault_queue;                /** Next fault per aircraft */
+  bool m_started = false;           /** simulate() has been called */
+  std::set<std::pair<double, int>> m_waiting; /** Aircraft waiting for a
+                                                 charger, by policy key */
+  std::vector<uint64_t> *m_hash_trace = nullptr; /** Hash per tick, if
+                                                    recording */
+  uint64_t *m_vehicle_hashes = nullptr;   /** State hash per aircraft, from
+                                             m_sim's arena */
+  uint64_t m_state_hash = 0;              /** Sum of m_vehicle_hashes */
+
+  /**
+   * @class BehaviorEngine
+   * @brief Queue a wake-up for an aircraft.
+   */
+  void wake_at(int tick, int index);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Run one tick.
+   */
+  void step();
+
+  /**
+   * @class BehaviorEngine
+   * @brief Update the state hash after an aircraft's mode or counts change.
+   */
+  void rehash(int index);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Change an aircraft's mode, accounting time spent in the old one.
+   * @param mode The new mode
+   * @param first_tick First tick spent in the new mode
+   */
+  void set_mode(int index, AircraftMode mode, int first_tick);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Start waiting for a charger at the current tick.
+   */
+  void begin_wait(int index);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Take a charger for a waiting aircraft.
+   * @param first_tick First tick the aircraft charges
+   */
+  void take_charger(int index, int first_tick);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Charge a waiting aircraft that just got a charger to full.
+   */
+  void begin_charge(int index);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Hand a free charger to the waiting aircraft the charger policy
+   * picks, as the aircraft at `index` gives it up.
+   */
+  void allocate_charger(int index);
+
+  /**
+   * @class BehaviorEngine
+   * @brief Bring the fleet up to date with the current tick, finishing
+   * partial phases.
+   */
+  void finish();
+};
+
+#endif /* BEHAVIOR_H */
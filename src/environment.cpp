@@ -0,0 +1,216 @@
+/**
+ * @file environment.cpp
+ * @brief Environment class implementation and loading.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "environment.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/*****************************************************************
+ * Member function definitions
+ *****************************************************************/
+
+/**
+ * @class Environment
+ * @brief Constructor for an environment with neutral conditions everywhere.
+ * @param regions Number of regions (columns), at most ENV_MAX_REGIONS
+ * @param bucket_ms Length of each time bucket (ms)
+ * @param buckets Number of time buckets (rows)
+ */
+Environment::Environment(int regions, int bucket_ms, int buckets)
+    : m_regions(regions), m_bucket_ms(bucket_ms), m_buckets(buckets) {
+  if (m_regions < 1) {
+    m_regions = 1;
+  } else if (m_regions > ENV_MAX_REGIONS) {
+    m_regions = ENV_MAX_REGIONS;
+  }
+
+  if (m_bucket_ms < 1) {
+    m_bucket_ms = MS_PER_HOUR;
+  }
+
+  if (m_buckets < 1) {
+    m_buckets = 1;
+  }
+
+  m_cells.resize((size_t)m_regions * m_buckets);
+}
+
+/**
+ * @brief Add a 32-bit value to an FNV-1a hash, a byte at a time.
+ */
+static uint64_t fnv1a_add(uint64_t hash, uint32_t value) {
+  for (int byte = 0; byte < 4; byte++) {
+    hash = (hash ^ ((value >> (8 * byte)) & 0xff)) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * @class Environment
+ * @brief Checksum of the grid dimensions and every cell, never 0. Two
+ * environments with the same checksum fly the same.
+ *
+ * FNV-1a over the fields, so padding and byte order don't matter.
+ */
+uint64_t Environment::checksum() const {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = fnv1a_add(hash, m_regions);
+  hash = fnv1a_add(hash, m_bucket_ms);
+  hash = fnv1a_add(hash, m_buckets);
+
+  for (const EnvCell &cell : m_cells) {
+    hash = fnv1a_add(hash, (uint8_t)cell.headwind_mph |
+                               ((uint8_t)cell.temperature_c << 8) |
+                               ((uint32_t)cell.airspace_capacity << 16));
+  }
+
+  return hash ? hash : 1;
+}
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Print an environment file error to stderr.
+ * @param path Path to the environment file
+ * @param line_num Line the error is on
+ * @param message What went wrong
+ * @return false, for convenience
+ */
+static bool environment_error(const char *path, int line_num,
+                              const std::string &message) {
+  std::cerr << path << ":" << line_num << ": " << message << std::endl;
+  return false;
+}
+
+/**
+ * @brief Read headwind, temperature and airspace capacity into a cell.
+ * @return false if any are missing or out of range
+ */
+static bool read_cell(std::istringstream &fields, EnvCell *cell) {
+  int headwind;
+  int temperature;
+  int capacity;
+
+  if (!(fields >> headwind >> temperature >> capacity) ||
+      headwind < INT8_MIN || headwind > INT8_MAX ||
+      temperature < INT8_MIN || temperature > INT8_MAX || capacity < 0 ||
+      capacity > AIRSPACE_UNLIMITED) {
+    return false;
+  }
+
+  cell->headwind_mph = (int8_t)headwind;
+  cell->temperature_c = (int8_t)temperature;
+  cell->airspace_capacity = (uint16_t)capacity;
+  return true;
+}
+
+/**
+ * @brief Read an environment file.
+ * @param path Path to the environment file
+ * @param environment Environment to fill in
+ * @return true on success. On failure, the problem is printed to stderr.
+ */
+bool load_environment(const char *path, Environment *environment) {
+  std::ifstream file(path);
+  if (!file) {
+    return environment_error(path, 0, "cannot open file");
+  }
+
+  int version = 0;
+  int regions = 1;
+  int bucket_ms = MS_PER_HOUR;
+  int buckets = 1;
+  bool have_grid = false;
+  std::string line;
+  int line_num = 0;
+
+  while (std::getline(file, line)) {
+    line_num++;
+
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+
+    std::istringstream fields(line);
+    std::string key;
+    if (!(fields >> key)) {
+      continue; // Blank line
+    }
+
+    if (!version && key != "version") {
+      return environment_error(path, line_num, "'version' must come first");
+    }
+
+    bool is_dimension =
+        (key == "regions" || key == "bucket_ms" || key == "buckets");
+    if (is_dimension && have_grid) {
+      return environment_error(path, line_num,
+                               "'" + key + "' must come before any cells");
+    }
+
+    if ((key == "fill" || key == "cell") && !have_grid) {
+      *environment = Environment(regions, bucket_ms, buckets);
+      have_grid = true;
+    }
+
+    bool ok = true;
+
+    if (key == "version") {
+      ok = (bool)(fields >> version);
+      if (ok && (version < 1 || version > ENVIRONMENT_VERSION)) {
+        return environment_error(path, line_num,
+                                 "unsupported version " +
+                                     std::to_string(version));
+      }
+    } else if (key == "regions") {
+      ok = (fields >> regions) && regions > 0 && regions <= ENV_MAX_REGIONS;
+    } else if (key == "bucket_ms") {
+      ok = (fields >> bucket_ms) && bucket_ms > 0;
+    } else if (key == "buckets") {
+      ok = (fields >> buckets) && buckets > 0;
+    } else if (key == "fill") {
+      EnvCell cell;
+      ok = read_cell(fields, &cell);
+      for (int i = 0; ok && i < buckets; i++) {
+        for (int j = 0; j < regions; j++) {
+          environment->cell(i, j) = cell;
+        }
+      }
+    } else if (key == "cell") {
+      int bucket;
+      int region;
+      ok = (fields >> bucket >> region) && bucket >= 0 && bucket < buckets &&
+           region >= 0 && region < regions &&
+           read_cell(fields, &environment->cell(bucket, region));
+    } else {
+      return environment_error(path, line_num, "unknown key '" + key + "'");
+    }
+
+    std::string extra;
+    if (!ok || (fields >> extra)) {
+      return environment_error(path, line_num,
+                               "bad value for '" + key + "'");
+    }
+  }
+
+  if (!version) {
+    return environment_error(path, line_num, "missing 'version'");
+  }
+
+  if (!have_grid) {
+    *environment = Environment(regions, bucket_ms, buckets);
+  }
+
+  return true;
+}
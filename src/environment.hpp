@@ -0,0 +1,156 @@
+/**
+ * @file environment.hpp
+ * @brief Environment class definition and file format.
+ */
+
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "common.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Newest environment file version this build can read. */
+constexpr int ENVIRONMENT_VERSION = 1;
+
+/** @brief Most vertiport regions an environment can have. */
+constexpr int ENV_MAX_REGIONS = 64;
+
+/** @brief Airspace capacity meaning "no limit". */
+constexpr int AIRSPACE_UNLIMITED = UINT16_MAX;
+
+/** @brief Temperature (C) below which batteries start losing capacity. */
+constexpr int ENV_COLD_TEMP_C = 15;
+
+/** @brief Extra energy used per degree below ENV_COLD_TEMP_C. */
+constexpr double ENV_COLD_PENALTY_PER_C = 0.01;
+
+/** @brief Slowest ground speed a headwind can cut an aircraft to, as a
+ * fraction of its cruise speed. */
+constexpr double ENV_MIN_GROUND_SPEED = 0.1;
+
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/** @brief Conditions in one region for one time bucket. Kept to 4 bytes so
+ * a whole day of conditions for every region stays cache resident. */
+struct EnvCell {
+  int8_t headwind_mph = 0;   /** Headwind (negative for a tailwind) */
+  int8_t temperature_c = 20; /** Air temperature */
+  uint16_t airspace_capacity = AIRSPACE_UNLIMITED; /** Most aircraft that can
+                                                      be flying at once */
+};
+
+static_assert(sizeof(EnvCell) == 4, "EnvCell should stay compact");
+
+/*****************************************************************
+ * Class definitions
+ *****************************************************************/
+
+/**
+ * @class Environment
+ * @brief Time-varying weather and airspace limits per vertiport region.
+ *
+ * Conditions are stored as a grid of EnvCell, one row per time bucket and one
+ * column per region. Sampling is a division to find the row, then an index
+ * into it, so the tick loop finds the row once per tick and each aircraft
+ * reads its region's cell directly.
+ *
+ * Times past the last bucket keep the last bucket's conditions.
+ */
+class Environment {
+public:
+  Environment(int regions = 1, int bucket_ms = MS_PER_HOUR, int buckets = 1);
+
+  /**
+   * @class Environment
+   * @brief Number of regions (columns).
+   */
+  int regions() const { return m_regions; }
+
+  /**
+   * @class Environment
+   * @brief Length of each time bucket (ms).
+   */
+  int bucket_ms() const { return m_bucket_ms; }
+
+  /**
+   * @class Environment
+   * @brief Number of time buckets (rows).
+   */
+  int buckets() const { return m_buckets; }
+
+  /**
+   * @class Environment
+   * @brief Get the conditions for one region and time bucket.
+   */
+  EnvCell &cell(int bucket, int region) {
+    return m_cells[(size_t)bucket * m_regions + region];
+  }
+
+  /**
+   * @class Environment
+   * @brief Get the conditions for every region at a point in time.
+   * @param time_ms Simulation time (ms)
+   * @return Array of regions() cells
+   */
+  const EnvCell *row(long long time_ms) const {
+    long long bucket = time_ms / m_bucket_ms;
+    if (bucket >= m_buckets) {
+      bucket = m_buckets - 1;
+    }
+
+    return &m_cells[(size_t)bucket * m_regions];
+  }
+
+  /**
+   * @class Environment
+   * @brief Checksum of the grid dimensions and every cell, never 0. Two
+   * environments with the same checksum fly the same.
+   */
+  uint64_t checksum() const;
+
+private:
+  int m_regions;   /** Regions (columns) */
+  int m_bucket_ms; /** Length of each time bucket (ms) */
+  int m_buckets;   /** Time buckets (rows) */
+  std::vector<EnvCell> m_cells; /** Row-major grid of conditions */
+};
+
+/*****************************************************************
+ * Function declarations
+ *****************************************************************/
+
+/**
+ * @brief Read an environment file.
+ * @param path Path to the environment file
+ * @param environment Environment to fill in
+ * @return true on success. On failure, the problem is printed to stderr.
+ *
+ * Environment files are plain text, one `key value...` entry per line, with
+ * `#` comments. `version` must come first, and the grid dimensions must come
+ * before any conditions. Cells not mentioned keep neutral conditions (still
+ * air, 20C, unlimited airspace). For example:
+ *
+ *   version 1
+ *   regions 4
+ *   bucket_ms 900000
+ *   buckets 12
+ *   # fill <headwind_mph> <temperature_c> <airspace_capacity>
+ *   fill 0 20 65535
+ *   # cell <bucket> <region> <headwind_mph> <temperature_c> <capacity>
+ *   cell 0 2 25 -5 4
+ */
+bool load_environment(const char *path, Environment *environment);
+
+#endif /* ENVIRONMENT_H */
@@ -0,0 +1,178 @@
+/**
+ * @file evtol_sim.cpp
+ * @brief C API for embedding the simulator.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "evtol_sim.h"
+#include "simulator.hpp"
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/** @brief The opaque handle: a simulator plus room for per-type totals. */
+struct evtol_sim {
+  Simulator sim;
+  evtol_type_stats type_stats[EVTOL_SIM_AIRCRAFT_TYPES];
+
+  evtol_sim(const SimulatorConfig &config) : sim(config) {}
+};
+
+static_assert(EVTOL_SIM_AIRCRAFT_TYPES == MAX_AIRCRAFT_TYPES,
+              "C API type count out of date");
+static_assert(sizeof(AircraftType) == sizeof(int32_t) &&
+                  sizeof(AircraftMode) == sizeof(int32_t),
+              "Aircraft enums must be viewable as int32");
+static_assert(sizeof(evtol_type_stats) == sizeof(TypeStats) &&
+                  offsetof(evtol_type_stats, flight_distance) ==
+                      offsetof(TypeStats, flight_distance),
+              "evtol_type_stats must match TypeStats");
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+int evtol_sim_abi_version(void) { return EVTOL_SIM_ABI_VERSION; }
+
+void evtol_sim_config_init(evtol_sim_config *config) {
+  SimulatorConfig defaults;
+
+  config->vehicle_count = defaults.vehicle_count;
+  config->charger_count = defaults.charger_count;
+  config->step_ms = defaults.step_ms;
+  config->seed = defaults.seed;
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    config->type_weights[i] = defaults.type_weights[i];
+  }
+  config->charger_policy = defaults.charger_policy;
+  config->range_prediction = defaults.range_prediction;
+}
+
+evtol_sim *evtol_sim_create(const evtol_sim_config *config) {
+  // Same limits as a scenario file
+  if (!config || config->vehicle_count < 0 || config->charger_count < 0 ||
+      config->step_ms <= 0 || config->charger_policy < 0 ||
+      config->charger_policy >= MAX_CHARGER_POLICIES) {
+    return nullptr;
+  }
+
+  SimulatorConfig sim_config;
+  sim_config.vehicle_count = config->vehicle_count;
+  sim_config.charger_count = config->charger_count;
+  sim_config.step_ms = config->step_ms;
+  sim_config.seed = config->seed;
+
+  int total_weight = 0;
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    if (config->type_weights[i] < 0) {
+      return nullptr;
+    }
+    sim_config.type_weights[i] = config->type_weights[i];
+    total_weight += config->type_weights[i];
+  }
+  if (total_weight <= 0) {
+    return nullptr;
+  }
+
+  sim_config.charger_policy = (ChargerPolicy)config->charger_policy;
+  sim_config.range_prediction = config->range_prediction != 0;
+
+  // No exceptions across the C boundary
+  try {
+    return new evtol_sim(sim_config);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void evtol_sim_destroy(evtol_sim *sim) { delete sim; }
+
+int evtol_sim_set_charger_policy(evtol_sim *sim, int32_t policy) {
+  if (policy < 0 || policy >= MAX_CHARGER_POLICIES) {
+    return -1;
+  }
+
+  sim->sim.set_charger_policy((ChargerPolicy)policy);
+  return 0;
+}
+
+void evtol_sim_set_range_prediction(evtol_sim *sim, int32_t enable) {
+  sim->sim.set_range_prediction(enable != 0);
+}
+
+void evtol_sim_step(evtol_sim *sim) { sim->sim.step(); }
+
+void evtol_sim_run(evtol_sim *sim, int64_t duration_ms) {
+  sim->sim.simulate(duration_ms);
+}
+
+int64_t evtol_sim_ticks(const evtol_sim *sim) { return sim->sim.ticks(); }
+
+int32_t evtol_sim_vehicle_count(const evtol_sim *sim) {
+  return sim->sim.vehicle_count();
+}
+
+int evtol_sim_vehicle_view(const evtol_sim *sim, evtol_vehicle_field field,
+                           evtol_view *view) {
+  const Aircraft *vehicles = sim->sim.vehicles();
+  size_t offset;
+
+  switch (field) {
+  case EVTOL_FIELD_TYPE:
+    offset = offsetof(Aircraft, m_type);
+    break;
+  case EVTOL_FIELD_MODE:
+    offset = offsetof(Aircraft, m_sim_mode);
+    break;
+  case EVTOL_FIELD_ENERGY:
+    offset = offsetof(Aircraft, m_sim_rem_energy);
+    break;
+  case EVTOL_FIELD_MILES:
+    offset = offsetof(Aircraft, m_sim_total_miles);
+    break;
+  case EVTOL_FIELD_PASSENGER_MILES:
+    offset = offsetof(Aircraft, m_sim_total_passenger_mi);
+    break;
+  case EVTOL_FIELD_FAULTS:
+    offset = offsetof(Aircraft, m_sim_total_num_faults);
+    break;
+  case EVTOL_FIELD_TRIPS:
+    offset = offsetof(Aircraft, m_sim_trips_started);
+    break;
+  case EVTOL_FIELD_CHARGE_SESSIONS:
+    offset = offsetof(Aircraft, m_sim_charging_sessions);
+    break;
+  case EVTOL_FIELD_TRIPS_STRANDED:
+    offset = offsetof(Aircraft, m_sim_trips_stranded);
+    break;
+  case EVTOL_FIELD_TRIPS_DEFERRED:
+    offset = offsetof(Aircraft, m_sim_trips_deferred);
+    break;
+  case EVTOL_FIELD_MODE_TICKS:
+    offset = offsetof(Aircraft, m_mode_ticks);
+    break;
+  default:
+    return -1;
+  }
+
+  // An empty fleet has no array to point into
+  view->stride = sizeof(Aircraft);
+  view->count = sim->sim.vehicle_count();
+  view->data = view->count ? (const char *)vehicles + offset : NULL;
+  return 0;
+}
+
+const evtol_type_stats *evtol_sim_type_stats(evtol_sim *sim) {
+  TypeStats stats[MAX_AIRCRAFT_TYPES];
+  sim->sim.collect_type_stats(stats);
+
+  memcpy(sim->type_stats, stats, sizeof(stats));
+  return sim->type_stats;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file evtol_sim.h
+ * @brief C API for embedding the simulator (libevtolsim).
+ *
+ * Everything here is plain C, so the library can be used from C, or from
+ * any language with a C FFI, without linking against C++ types.
+ *
+ * Results are not formatted or copied out: evtol_sim_vehicle_view() returns
+ * a strided view straight over the simulator's own fleet array, so reading
+ * results costs nothing beyond the reads themselves.
+ */
+
+#ifndef EVTOL_SIM_H
+#define EVTOL_SIM_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Version of this API. Bumped on any incompatible change to the
+ * functions or structs below. */
+#define EVTOL_SIM_ABI_VERSION 1
+
+/** @brief Number of aircraft types (entries in a type stats array). */
+#define EVTOL_SIM_AIRCRAFT_TYPES 5
+
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/** @brief A simulator instance. Opaque. */
+typedef struct evtol_sim evtol_sim;
+
+/** @brief Everything needed to create a simulator. Fill in the defaults
+ * with evtol_sim_config_init() and then change what you need. */
+typedef struct evtol_sim_config {
+  int32_t vehicle_count;  /** Vehicles in the fleet */
+  int32_t charger_count;  /** Available chargers */
+  int32_t step_ms;        /** Time step interval (ms) */
+  uint32_t seed;          /** Seed for random numbers */
+  int32_t type_weights[EVTOL_SIM_AIRCRAFT_TYPES]; /** Relative share of
+                                                     each type in the fleet */
+  int32_t charger_policy;   /** 0 FIFO, 1 LowestEnergy, 2 ShortestCharge,
+                                3 EarliestArrival, 4 Reservation */
+  int32_t range_prediction; /** Nonzero to check range before dispatching */
+} evtol_sim_config;
+
+/** @brief Per-vehicle fields that can be viewed. */
+typedef enum evtol_vehicle_field {
+  EVTOL_FIELD_TYPE,            /** int32: 0 Alpha ... 4 Echo */
+  EVTOL_FIELD_MODE,            /** int32: 0 Idle, 1 WaitingToCharge,
+                                   2 ChargeComplete, 3 Charging, 4 Flying */
+  EVTOL_FIELD_ENERGY,          /** double: remaining battery (kWh) */
+  EVTOL_FIELD_MILES,           /** double: miles flown */
+  EVTOL_FIELD_PASSENGER_MILES, /** double: passenger miles flown */
+  EVTOL_FIELD_FAULTS,          /** int32: faults */
+  EVTOL_FIELD_TRIPS,           /** int32: trips started */
+  EVTOL_FIELD_CHARGE_SESSIONS, /** int32: charging sessions */
+  EVTOL_FIELD_TRIPS_STRANDED,  /** int32: trips that ran out of battery */
+  EVTOL_FIELD_TRIPS_DEFERRED,  /** int32: trips turned down to charge */
+  EVTOL_FIELD_MODE_TICKS,      /** int32[5]: ticks spent in each mode */
+  EVTOL_MAX_VEHICLE_FIELDS,
+} evtol_vehicle_field;
+
+/**
+ * @brief A strided view of one field across the fleet.
+ *
+ * Vehicle i's value is at `(const char *)data + i * stride`. The view points
+ * into the simulator's own memory: it stays valid until the simulator is
+ * destroyed, and always shows the current state (it is not a snapshot).
+ */
+typedef struct evtol_view {
+  const void *data; /** First vehicle's value */
+  size_t stride;    /** Bytes from one vehicle's value to the next */
+  size_t count;     /** Number of vehicles */
+} evtol_view;
+
+/** @brief Per-type totals. Hours can be derived from ticks and step_ms. */
+typedef struct evtol_type_stats {
+  int64_t vehicle_count;   /** Vehicles of this type */
+  int64_t flights;         /** Trips started */
+  int64_t flight_ticks;    /** Ticks spent flying */
+  int64_t chg_ticks;       /** Ticks spent charging */
+  int64_t chg_sessions;    /** Charging sessions */
+  int64_t faults;          /** Faults */
+  int64_t passenger_miles; /** Passenger miles (whole miles per vehicle) */
+  double flight_distance;  /** Miles flown */
+} evtol_type_stats;
+
+/*****************************************************************
+ * Function declarations
+ *****************************************************************/
+
+/**
+ * @brief Version of the API the library was built with. Compare against
+ * EVTOL_SIM_ABI_VERSION.
+ */
+int evtol_sim_abi_version(void);
+
+/**
+ * @brief Fill in the default configuration (the original 20 vehicle,
+ * 3 charger fleet).
+ * @param config Configuration to fill in
+ */
+void evtol_sim_config_init(evtol_sim_config *config);
+
+/**
+ * @brief Create a simulator.
+ * @param config Configuration. Not referenced after the call.
+ * @return The simulator, or NULL if the configuration is invalid or there
+ * isn't enough memory.
+ */
+evtol_sim *evtol_sim_create(const evtol_sim_config *config);
+
+/**
+ * @brief Destroy a simulator. Any views of it become invalid.
+ * @param sim The simulator, or NULL
+ */
+void evtol_sim_destroy(evtol_sim *sim);
+
+/**
+ * @brief Change the charger allocation policy, between ticks.
+ * @return 0 on success, -1 if the policy is out of range
+ */
+int evtol_sim_set_charger_policy(evtol_sim *sim, int32_t policy);
+
+/**
+ * @brief Turn range prediction on (nonzero) or off (zero), between ticks.
+ */
+void evtol_sim_set_range_prediction(evtol_sim *sim, int32_t enable);
+
+/**
+ * @brief Run a single tick.
+ */
+void evtol_sim_step(evtol_sim *sim);
+
+/**
+ * @brief Run for a duration, as a whole number of ticks (rounded up).
+ * @param duration_ms Sim time, in milliseconds
+ */
+void evtol_sim_run(evtol_sim *sim, int64_t duration_ms);
+
+/**
+ * @brief Elapsed simulation ticks.
+ */
+int64_t evtol_sim_ticks(const evtol_sim *sim);
+
+/**
+ * @brief Number of aircraft in the fleet.
+ */
+int32_t evtol_sim_vehicle_count(const evtol_sim *sim);
+
+/**
+ * @brief Get a view of one per-vehicle field.
+ * @param field The field to view
+ * @param view View to fill in
+ * @return 0 on success, -1 if the field is out of range
+ *
+ * An empty fleet gives a view with data NULL and count 0.
+ */
+int evtol_sim_vehicle_view(const evtol_sim *sim, evtol_vehicle_field field,
+                           evtol_view *view);
+
+/**
+ * @brief Total up per-type statistics over the fleet.
+ * @return Array of EVTOL_SIM_AIRCRAFT_TYPES entries, owned by the simulator.
+ * Valid until the next call for the same simulator, or until it is
+ * destroyed.
+ */
+const evtol_type_stats *evtol_sim_type_stats(evtol_sim *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVTOL_SIM_H */
@@ -7,28 +7,309 @@
  * Includes
  *****************************************************************/
 
+#include "behavior.hpp"
 #include "common.hpp"
+#include "partition.hpp"
+#include "policy_comparison.hpp"
+#include "scenario.hpp"
 #include "simulator.hpp"
+#include "state_hash.hpp"
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
 
 /*****************************************************************
  * Constants
  *****************************************************************/
 
-constexpr int SIM_DURATION_MS = MS_PER_HOUR * 3;
+constexpr long long SIM_DURATION_MS = MS_PER_HOUR * 3LL;
+constexpr unsigned int SIM_SEED = 12452;
 
 /*****************************************************************
  * Function definitions
  *****************************************************************/
 
-int main() {
-  srand(12452);
+/**
+ * @brief Print command line usage.
+ */
+static void print_usage(const char *program) {
+  std::cerr << "Usage: " << program << " [options]" << std::endl
+            << "  --scenario <file>    Run a scenario file instead of the "
+               "built-in fleet (give --policy, --range-prediction, "
+               "--environment and --duration after it)"
+            << std::endl
+            << "  --policy <name>      Charger policy (FIFO, LowestEnergy, "
+               "ShortestCharge, EarliestArrival, Reservation)"
+            << std::endl
+            << "  --compare-policies   Run every charger policy on the same "
+               "fleet and faults"
+            << std::endl
+            << "  --range-prediction   Only dispatch trips the battery can "
+               "finish"
+            << std::endl
+            << "  --environment <file> Weather and airspace limits (see "
+               "src/environment.hpp)"
+            << std::endl
+            << "  --dispatch-stats     Also report stranded/deferred trips"
+            << std::endl
+            << "  --behavior-engine    Run on the coroutine behavior engine "
+               "(no environments or Reservation)"
+            << std::endl
+            << "  --duration <ms>      Simulated time" << std::endl
+            << "  --hash-trace <file>  Record a fleet state hash per tick "
+               "(see tools/diff_results.py)"
+            << std::endl
+            << "  --hash-energy        Include battery energy in the hash "
+               "trace (not on the behavior engine)"
+            << std::endl
+            << "  --vehicle-state      Also report each vehicle's final state"
+            << std::endl
+            << "  --save-image <file>  Save the fleet after the run, for "
+               "--load-image"
+            << std::endl
+            << "  --load-image <file>  Continue from a saved fleet instead of "
+               "starting fresh (--policy and --range-prediction after it "
+               "override it)"
+            << std::endl
+            << "  --reset-stats        With --load-image, leave the image's "
+               "ticks out of the reports"
+            << std::endl
+            << "  --shards <n>         Split the fleet and chargers across n "
+               "worker processes"
+            << std::endl
+            << "  --golden             Output the full regression report "
+               "(see tests/golden)"
+            << std::endl;
+}
+
+int main(int argc, char **argv) {
+  Scenario scenario;
+  scenario.config.seed = SIM_SEED;
+  scenario.duration_ms = SIM_DURATION_MS;
+
+  bool compare_policies = false;
+  bool dispatch_stats = false;
+  bool golden = false;
+  bool behavior_engine = false;
+  bool vehicle_state = false;
+  const char *hash_trace_path = nullptr;
+  bool hash_energy = false;
+  const char *save_image_path = nullptr;
+  const char *load_image_path = nullptr;
+  bool reset_stats = false;
+  bool policy_given = false; // After --load-image
+  bool range_given = false;  // After --load-image
+  const char *scenario_option = nullptr; // Would be reset by --scenario
+  int shards = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "--scenario") && i + 1 < argc) {
+      if (scenario_option) {
+        std::cerr << scenario_option << " must come after --scenario, "
+                  << "which would override it" << std::endl;
+        return 1;
+      }
+      if (!load_scenario(argv[++i], &scenario)) {
+        return 1;
+      }
+    } else if (0 == strcmp(argv[i], "--environment") && i + 1 < argc) {
+      scenario_option = argv[i];
+      if (!set_scenario_environment(argv[++i], &scenario)) {
+        return 1;
+      }
+    } else if (0 == strcmp(argv[i], "--compare-policies")) {
+      compare_policies = true;
+    } else if (0 == strcmp(argv[i], "--range-prediction")) {
+      scenario_option = argv[i];
+      scenario.config.range_prediction = true;
+      range_given = true;
+    } else if (0 == strcmp(argv[i], "--dispatch-stats")) {
+      dispatch_stats = true;
+    } else if (0 == strcmp(argv[i], "--behavior-engine")) {
+      behavior_engine = true;
+    } else if (0 == strcmp(argv[i], "--vehicle-state")) {
+      vehicle_state = true;
+    } else if (0 == strcmp(argv[i], "--hash-trace") && i + 1 < argc) {
+      hash_trace_path = argv[++i];
+    } else if (0 == strcmp(argv[i], "--hash-energy")) {
+      hash_energy = true;
+    } else if (0 == strcmp(argv[i], "--duration") && i + 1 < argc) {
+      scenario_option = argv[i];
+      scenario.duration_ms = atoll(argv[++i]);
+      if (scenario.duration_ms < 0) {
+        print_usage(argv[0]);
+        return 1;
+      }
+    } else if (0 == strcmp(argv[i], "--golden")) {
+      golden = true;
+    } else if (0 == strcmp(argv[i], "--shards") && i + 1 < argc) {
+      shards = atoi(argv[++i]);
+      if (shards < 1 || shards > MAX_SHARDS) {
+        print_usage(argv[0]);
+        return 1;
+      }
+    } else if (0 == strcmp(argv[i], "--policy") && i + 1 < argc) {
+      scenario_option = argv[i];
+      i++;
+      int j = 0;
+      while (j < MAX_CHARGER_POLICIES &&
+             strcmp(argv[i], charger_policy_str[j])) {
+        j++;
+      }
+      if (j == MAX_CHARGER_POLICIES) {
+        print_usage(argv[0]);
+        return 1;
+      }
+      scenario.config.charger_policy = (ChargerPolicy)j;
+      policy_given = true;
+    } else if (0 == strcmp(argv[i], "--save-image") && i + 1 < argc) {
+      save_image_path = argv[++i];
+    } else if (0 == strcmp(argv[i], "--load-image") && i + 1 < argc) {
+      load_image_path = argv[++i];
+      policy_given = false;
+      range_given = false;
+    } else if (0 == strcmp(argv[i], "--reset-stats")) {
+      reset_stats = true;
+    } else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (compare_policies) {
+    std::cout << "Simulating " << MAX_CHARGER_POLICIES << " policies for "
+              << scenario.duration_ms << "ms" << std::endl;
+
+    PolicyComparison comparison(scenario.config);
+    comparison.simulate(scenario.duration_ms);
+    comparison.report_policy_stats();
+    return 0;
+  }
+
+  if (shards > 0) {
+    std::cout << "Simulating for " << scenario.duration_ms << "ms across "
+              << shards << " shards" << std::endl;
+
+    TypeStats stats[MAX_AIRCRAFT_TYPES];
+    long long handoffs = 0;
+    if (!run_partitioned(scenario, shards, stats, &handoffs)) {
+      return 1;
+    }
+
+    report_type_stats(stats, scenario.config.step_ms, std::cout);
+    std::cout << "Shards,Handoffs" << std::endl
+              << shards << "," << handoffs << std::endl;
+    return 0;
+  }
+
+  if (behavior_engine && !BehaviorEngine::supports(scenario.config)) {
+    std::cerr << "The behavior engine does not support environments or the "
+                 "Reservation policy"
+              << std::endl;
+    return 1;
+  }
+
+  if (behavior_engine && (save_image_path || load_image_path)) {
+    std::cerr << "The behavior engine does not support fleet images"
+              << std::endl;
+    return 1;
+  }
+
+  if (behavior_engine && hash_energy) {
+    std::cerr << "The behavior engine cannot hash battery energy"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<uint64_t> trace;
+  std::vector<uint64_t> *trace_ptr = hash_trace_path ? &trace : nullptr;
+
+  // The engine owns its simulator; either way, report from a Simulator
+  std::unique_ptr<BehaviorEngine> engine;
+  std::unique_ptr<Simulator> direct_sim;
+  Simulator *sim;
+  int start_tick = 0; // Where this run (and its hash trace) starts
+
+  if (behavior_engine) {
+    engine = std::make_unique<BehaviorEngine>(scenario.config);
+    engine->set_hash_trace(trace_ptr);
+    engine->simulate(scenario.duration_ms);
+    sim = &engine->simulator();
+  } else if (load_image_path) {
+    direct_sim = std::make_unique<Simulator>(0, scenario.config.seed);
+    if (!direct_sim->load_image(load_image_path,
+                                scenario.config.environment)) {
+      return 1;
+    }
+
+    start_tick = direct_sim->ticks();
+    if (reset_stats) {
+      direct_sim->reset_stats();
+    }
+
+    // What-if: policies given after the image override the saved ones
+    if (policy_given) {
+      direct_sim->set_charger_policy(scenario.config.charger_policy);
+    }
+    if (range_given) {
+      direct_sim->set_range_prediction(true);
+    }
+
+    direct_sim->set_hash_trace(trace_ptr, hash_energy);
+    direct_sim->simulate(scenario.duration_ms);
+    sim = direct_sim.get();
+  } else {
+    direct_sim = std::make_unique<Simulator>(scenario.config);
+    direct_sim->set_hash_trace(trace_ptr, hash_energy);
+    direct_sim->simulate(scenario.duration_ms);
+    sim = direct_sim.get();
+  }
+
+  if (golden) {
+    report_scenario(scenario, *sim, std::cout);
+  } else {
+    std::cout << "Simulating for " << scenario.duration_ms << "ms"
+              << (behavior_engine ? " on the behavior engine" : "");
+    if (load_image_path) {
+      std::cout << " from a fleet image at "
+                << (long long)start_tick * sim->step_ms()
+                << "ms; reports cover "
+                << (long long)sim->stats_start_tick() * sim->step_ms()
+                << "ms to " << (long long)sim->ticks() * sim->step_ms() << "ms";
+    }
+    std::cout << std::endl;
+
+    // sim->report_time_per_mode();
+    sim->report_vehicle_type_stats();
+
+    if (dispatch_stats) {
+      sim->report_dispatch_stats();
+    }
+
+    if (scenario.environment) {
+      sim->report_environment_stats();
+    }
+  }
+
+  if (vehicle_state) {
+    sim->report_vehicle_state();
+  }
 
-  Simulator sim(MAX_VEHICLES);
-  sim.simulate(SIM_DURATION_MS);
+  if (save_image_path && !sim->save_image(save_image_path)) {
+    return 1;
+  }
 
-  // sim.report_time_per_mode();
-  sim.report_vehicle_type_stats();
+  if (hash_trace_path) {
+    std::ofstream file(hash_trace_path);
+    if (!file) {
+      std::cerr << hash_trace_path << ": cannot open file" << std::endl;
+      return 1;
+    }
+    write_hash_trace(trace, sim->step_ms(), start_tick, hash_energy, file);
+  }
 
   return 0;
 }
@@ -0,0 +1,357 @@
+/**
+ * @file partition.cpp
+ * @brief Multi-process partitioned simulation.
+ *
+ * The parent process forks one worker per shard and talks to each over a
+ * Unix socket pair. Workers and the coordinator move in lockstep, one
+ * message each way per tick.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "partition.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/** @brief Coordinator -> shard, once per tick, followed by `arrivals`
+ * Aircraft records. */
+struct ShardDirective {
+  int32_t arrivals; /** Aircraft arriving from other shards */
+  int32_t handoffs; /** Waiting aircraft to hand off before this tick */
+  int32_t done;     /** Add the arrivals, report stats and exit */
+};
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Write a whole buffer to a socket.
+ * @return false if the other end has gone away
+ */
+static bool write_all(int fd, const void *buf, size_t len) {
+  const char *bytes = (const char *)buf;
+
+  while (len > 0) {
+    ssize_t n = send(fd, bytes, len, MSG_NOSIGNAL);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Read a whole buffer from a socket.
+ * @return false if the other end has gone away
+ */
+static bool read_all(int fd, void *buf, size_t len) {
+  char *bytes = (char *)buf;
+
+  while (len > 0) {
+    ssize_t n = recv(fd, bytes, len, 0);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Share of `total` that goes to a shard, spreading the remainder over
+ * the first shards.
+ */
+static int shard_share(int total, int shard, int shard_count) {
+  return total / shard_count + (shard < total % shard_count ? 1 : 0);
+}
+
+/**
+ * @brief Number of ticks Simulator::simulate() runs for a duration.
+ */
+static long long ticks_for(long long duration_ms, int step_ms) {
+  return (duration_ms + step_ms - 1) / step_ms;
+}
+
+/**
+ * @brief Worker process body: run one shard's tick loop.
+ * @param fd Socket to the coordinator
+ * @param scenario The whole scenario
+ * @param shard This shard's index
+ * @param shard_count Number of shards
+ * @return Process exit status
+ */
+static int run_shard(int fd, const Scenario &scenario, int shard,
+                     int shard_count) {
+  SimulatorConfig config = scenario.config;
+  config.vehicle_count =
+      shard_share(scenario.config.vehicle_count, shard, shard_count);
+  config.charger_count =
+      shard_share(scenario.config.charger_count, shard, shard_count);
+  config.seed = scenario.config.seed + shard;
+
+  // Each tick's arrivals fit in the chargers that were spare when they were
+  // routed, so leave room for one per charger. A shard that keeps taking
+  // aircraft in grows its fleet past that.
+  config.vehicle_capacity = config.vehicle_count + config.charger_count;
+
+  Simulator sim(config);
+  std::vector<Aircraft> transit;
+
+  while (true) {
+    ShardDirective directive;
+    if (!read_all(fd, &directive, sizeof(directive))) {
+      return 1;
+    }
+
+    transit.resize(directive.arrivals);
+    if (!read_all(fd, transit.data(), transit.size() * sizeof(Aircraft))) {
+      return 1;
+    }
+
+    for (Aircraft &vehicle : transit) {
+      // The tick spent in transit counts as waiting for a charger
+      vehicle.m_mode_ticks[MODE__WAITING_TO_CHARGE]++;
+      vehicle.m_sim_ticks_waiting_chg++;
+
+      if (!sim.add_vehicle(vehicle)) {
+        std::cerr << "shard " << shard << ": no memory for arriving aircraft"
+                  << std::endl;
+        return 1;
+      }
+    }
+
+    if (directive.done) {
+      break;
+    }
+
+    transit.clear();
+    Aircraft vehicle;
+    while ((int)transit.size() < directive.handoffs &&
+           sim.take_next_to_charge(&vehicle)) {
+      transit.push_back(vehicle);
+    }
+
+    sim.step();
+
+    ShardReport report;
+    report.free_chargers = sim.free_chargers();
+    report.waiting = sim.waiting_count();
+    report.departures = (int32_t)transit.size();
+
+    if (!write_all(fd, &report, sizeof(report)) ||
+        !write_all(fd, transit.data(), transit.size() * sizeof(Aircraft))) {
+      return 1;
+    }
+  }
+
+  TypeStats stats[MAX_AIRCRAFT_TYPES];
+  sim.collect_type_stats(stats);
+
+  return write_all(fd, stats, sizeof(stats)) ? 0 : 1;
+}
+
+/**
+ * @brief Match shards with more waiting aircraft than free chargers to
+ * shards with spare chargers, greedily in shard order.
+ * @param reports Latest report from each shard
+ * @param pending Aircraft already on their way to each shard
+ * @param routes Filled in with the handoffs to make
+ * @param quotas Filled in with how many aircraft each shard should hand off
+ *
+ * Aircraft in transit join their new shard's queue next tick, so they count
+ * against its free chargers as well as the ones already waiting there.
+ */
+void match_handoffs(const std::vector<ShardReport> &reports,
+                    const std::vector<int> &pending,
+                    std::vector<ShardRoute> *routes, std::vector<int> *quotas) {
+  int shard_count = (int)reports.size();
+  std::vector<int> spare(shard_count);
+
+  for (int i = 0; i < shard_count; i++) {
+    spare[i] = reports[i].free_chargers - reports[i].waiting - pending[i];
+    (*quotas)[i] = 0;
+  }
+
+  routes->clear();
+  int dst = 0;
+
+  for (int src = 0; src < shard_count; src++) {
+    int excess = -spare[src];
+
+    while (excess > 0) {
+      while (dst < shard_count && spare[dst] <= 0) {
+        dst++;
+      }
+      if (dst == shard_count) {
+        return;
+      }
+
+      int count = excess < spare[dst] ? excess : spare[dst];
+      routes->push_back({src, dst, count});
+      (*quotas)[src] += count;
+      excess -= count;
+      spare[dst] -= count;
+    }
+  }
+}
+
+/**
+ * @brief Run a scenario split across several processes.
+ * @param scenario The scenario to run
+ * @param shard_count Number of shards (worker processes)
+ * @param stats Array of MAX_AIRCRAFT_TYPES entries to fill in with the merged
+ * per-type statistics
+ * @param handoffs If not null, set to the number of aircraft handed off
+ * between shards
+ * @return true on success. On failure, the problem is printed to stderr.
+ */
+bool run_partitioned(const Scenario &scenario, int shard_count,
+                     TypeStats *stats, long long *handoffs) {
+  if (shard_count < 1 || shard_count > MAX_SHARDS) {
+    std::cerr << "shard count must be 1-" << MAX_SHARDS << std::endl;
+    return false;
+  }
+
+  // Don't let the workers inherit (and later flush) buffered output
+  std::cout.flush();
+  fflush(nullptr);
+
+  std::vector<int> fds;
+  std::vector<pid_t> pids;
+  bool ok = true;
+
+  for (int shard = 0; shard < shard_count && ok; shard++) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+      perror("socketpair");
+      ok = false;
+      break;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      close(pair[0]);
+      close(pair[1]);
+      ok = false;
+      break;
+    }
+
+    if (pid == 0) {
+      for (int fd : fds) {
+        close(fd);
+      }
+      close(pair[0]);
+      _exit(run_shard(pair[1], scenario, shard, shard_count));
+    }
+
+    close(pair[1]);
+    fds.push_back(pair[0]);
+    pids.push_back(pid);
+  }
+
+  std::vector<ShardReport> reports(fds.size());
+  std::vector<std::vector<Aircraft>> departures(fds.size());
+  std::vector<std::vector<Aircraft>> arrivals(fds.size());
+  std::vector<ShardRoute> routes;
+  std::vector<int> quotas(fds.size(), 0);
+  std::vector<int> pending(fds.size(), 0);
+  long long total_handoffs = 0;
+  long long ticks = ticks_for(scenario.duration_ms, scenario.config.step_ms);
+
+  for (long long tick = 0; ok && tick <= ticks; tick++) {
+    bool done = (tick == ticks);
+
+    for (size_t i = 0; ok && i < fds.size(); i++) {
+      ShardDirective directive;
+      directive.arrivals = (int32_t)arrivals[i].size();
+      directive.handoffs = quotas[i];
+      directive.done = done;
+
+      ok = write_all(fds[i], &directive, sizeof(directive)) &&
+           write_all(fds[i], arrivals[i].data(),
+                     arrivals[i].size() * sizeof(Aircraft));
+      arrivals[i].clear();
+    }
+
+    if (done) {
+      break;
+    }
+
+    for (size_t i = 0; ok && i < fds.size(); i++) {
+      ok = read_all(fds[i], &reports[i], sizeof(ShardReport));
+      if (ok) {
+        departures[i].resize(reports[i].departures);
+        ok = read_all(fds[i], departures[i].data(),
+                      departures[i].size() * sizeof(Aircraft));
+      }
+    }
+
+    // Send this tick's departures where they were routed last tick
+    std::vector<size_t> sent(fds.size(), 0);
+    for (const ShardRoute &route : routes) {
+      const std::vector<Aircraft> &from = departures[route.src];
+      size_t &next = sent[route.src];
+
+      for (int j = 0; j < route.count && next < from.size(); j++) {
+        arrivals[route.dst].push_back(from[next++]);
+        total_handoffs++;
+      }
+    }
+
+    for (size_t i = 0; i < fds.size(); i++) {
+      pending[i] = (int)arrivals[i].size();
+    }
+    match_handoffs(reports, pending, &routes, &quotas);
+  }
+
+  // Merge in shard order
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    stats[i] = TypeStats();
+  }
+
+  for (size_t i = 0; ok && i < fds.size(); i++) {
+    TypeStats shard_stats[MAX_AIRCRAFT_TYPES];
+    ok = read_all(fds[i], shard_stats, sizeof(shard_stats));
+    if (ok) {
+      merge_type_stats(stats, shard_stats);
+    }
+  }
+
+  for (size_t i = 0; i < fds.size(); i++) {
+    close(fds[i]);
+
+    int status;
+    if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    std::cerr << "partitioned run failed" << std::endl;
+    return false;
+  }
+
+  if (handoffs) {
+    *handoffs = total_handoffs;
+  }
+
+  return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file partition.hpp
+ * @brief Multi-process partitioned simulation.
+ */
+
+#ifndef PARTITION_H
+#define PARTITION_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "scenario.hpp"
+#include "simulator.hpp"
+#include <cstdint>
+#include <vector>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Most shards (processes) a partitioned run can use. */
+constexpr int MAX_SHARDS = 256;
+
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/** @brief Shard -> coordinator, once per tick, followed by `departures`
+ * Aircraft records. */
+struct ShardReport {
+  int32_t free_chargers; /** Chargers free at the end of the tick */
+  int32_t waiting;       /** Aircraft waiting at the end of the tick */
+  int32_t departures;    /** Aircraft handed off before the tick */
+};
+
+/** @brief Aircraft to move from one shard to another. */
+struct ShardRoute {
+  int src;   /** Shard handing off */
+  int dst;   /** Shard receiving */
+  int count; /** Number of aircraft */
+};
+
+/*****************************************************************
+ * Function declarations
+ *****************************************************************/
+
+/**
+ * @brief Run a scenario split across several processes.
+ * @param scenario The scenario to run
+ * @param shard_count Number of shards (worker processes)
+ * @param stats Array of MAX_AIRCRAFT_TYPES entries to fill in with the merged
+ * per-type statistics
+ * @param handoffs If not null, set to the number of aircraft handed off
+ * between shards
+ * @return true on success. On failure, the problem is printed to stderr.
+ *
+ * Each shard is a vertiport: it gets an even share of the fleet and of the
+ * chargers, its own random seed (scenario seed + shard index), and runs its
+ * own tick loop in a forked worker process. The parent process coordinates
+ * over a Unix socket per shard.
+ *
+ * Every tick, each shard reports how many chargers it has free and how many
+ * aircraft are waiting. Where one shard has aircraft waiting that another has
+ * free chargers for, the coordinator tells the busy shard to hand them off,
+ * never more than those chargers less the aircraft already on their way.
+ * They spend one tick in transit, counted as waiting for a charger (a fault
+ * due then is counted on arrival), and join the end of the other shard's
+ * fleet and its charger queue.
+ * Only those aircraft and the per-tick counts cross process boundaries.
+ *
+ * Matching is greedy in shard order and stats are merged in shard order, so
+ * the results depend only on the scenario and shard count, never on process
+ * scheduling. A single shard gives exactly the same results as Simulator.
+ */
+bool run_partitioned(const Scenario &scenario, int shard_count,
+                     TypeStats *stats, long long *handoffs = nullptr);
+
+/**
+ * @brief Match shards with more waiting aircraft than free chargers to
+ * shards with spare chargers, greedily in shard order.
+ * @param reports Latest report from each shard
+ * @param pending Aircraft already on their way to each shard
+ * @param routes Filled in with the handoffs to make
+ * @param quotas Filled in with how many aircraft each shard should hand off
+ * (one entry per shard)
+ *
+ * A shard is only sent as many aircraft as it has chargers free, less the
+ * aircraft already waiting there and those still in transit to it.
+ */
+void match_handoffs(const std::vector<ShardReport> &reports,
+                    const std::vector<int> &pending,
+                    std::vector<ShardRoute> *routes, std::vector<int> *quotas);
+
+#endif /* PARTITION_H */
@@ -0,0 +1,116 @@
+/**
+ * @file policy_comparison.cpp
+ * @brief PolicyComparison class implementation.
+ *
+ * Runs the charger policies side by side so they can be compared under
+ * identical conditions.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "policy_comparison.hpp"
+#include <algorithm>
+#include <iostream>
+#include <new>
+
+/*****************************************************************
+ * Member function definitions
+ *****************************************************************/
+
+/**
+ * @class PolicyComparison
+ * @brief Constructor for policy comparison.
+ * @param config Simulator config. The charger policy is ignored.
+ */
+PolicyComparison::PolicyComparison(const SimulatorConfig &config)
+    : m_shared(config), m_split_tick(-1),
+      m_arena(MAX_CHARGER_POLICIES *
+              (sizeof(Simulator) +
+               Simulator::arena_bytes(std::max(config.vehicle_count,
+                                               config.vehicle_capacity)))) {
+  m_shared.set_defer_contested(true);
+}
+
+PolicyComparison::~PolicyComparison() {
+  for (int i = 0; i < MAX_CHARGER_POLICIES; i++) {
+    if (m_variants[i]) {
+      m_variants[i]->~Simulator();
+    }
+  }
+}
+
+/**
+ * @class PolicyComparison
+ * @brief Run a complete simulation for every policy.
+ * @param duration_ms Sim time, in milliseconds
+ */
+void PolicyComparison::simulate(long long duration_ms) {
+  long long time = 0;
+  int step_ms = m_shared.step_ms();
+
+  // Shared phase: one simulator stands in for all policies
+  for (; time < duration_ms && !m_variants[0]; time += step_ms) {
+    if (!m_shared.step()) {
+      split();
+    }
+  }
+
+  if (!m_variants[0]) {
+    split();
+  }
+
+  // Lockstep phase: advance every policy one tick at a time
+  for (; time < duration_ms; time += step_ms) {
+    for (int i = 0; i < MAX_CHARGER_POLICIES; i++) {
+      m_variants[i]->step();
+    }
+  }
+}
+
+/**
+ * @class PolicyComparison
+ * @brief Copy the shared simulator once per policy.
+ *
+ * If the shared simulator is paused at a contested allocation, each copy
+ * resolves it with its own policy and finishes the paused tick.
+ */
+void PolicyComparison::split() {
+  bool paused = m_shared.allocation_pending();
+
+  if (paused) {
+    m_split_tick = m_shared.ticks();
+  }
+
+  for (int i = 0; i < MAX_CHARGER_POLICIES; i++) {
+    void *memory = m_arena.allocate(sizeof(Simulator), alignof(Simulator));
+    m_variants[i] = new (memory) Simulator(m_shared, &m_arena);
+    m_variants[i]->set_defer_contested(false);
+    m_variants[i]->set_charger_policy((ChargerPolicy)i);
+
+    if (paused) {
+      m_variants[i]->resolve_pending_allocation();
+      m_variants[i]->step();
+    }
+  }
+}
+
+/**
+ * @class PolicyComparison
+ * @brief Output CSV report comparing fleet statistics for each policy.
+ * @param out Stream to write the report to
+ */
+void PolicyComparison::report_policy_stats(std::ostream &out) {
+  // CSV header
+  out << "Policy,WaitPerChgSession(Hours),ChargerUtilization,"
+         "TotalPassengerMiles,TotalFaults"
+      << std::endl;
+
+  for (int i = 0; i < MAX_CHARGER_POLICIES; i++) {
+    FleetStats stats = m_variants[i]->fleet_stats();
+    out << charger_policy_str[i] << "," << stats.wait_per_session << ","
+        << stats.utilization << "," << stats.passenger_miles << ","
+        << stats.faults << std::endl;
+  }
+}
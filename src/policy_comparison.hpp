@@ -0,0 +1,89 @@
+/**
+ * @file policy_comparison.hpp
+ * @brief PolicyComparison class definition.
+ */
+
+#ifndef POLICY_COMPARISON_H
+#define POLICY_COMPARISON_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "arena.hpp"
+#include "simulator.hpp"
+
+/*****************************************************************
+ * Class definition
+ *****************************************************************/
+
+/**
+ * @class PolicyComparison
+ * @brief Runs every charger policy against the same fleet, demand and faults.
+ *
+ * All policies behave identically until the first time a charger frees up
+ * while two or more aircraft are waiting and the policies disagree on who gets
+ * it. Up to that point a single shared simulator runs on behalf of all of
+ * them. At that point it is copied once per policy, each copy resolves the
+ * allocation its own way, and the copies then run in lockstep.
+ *
+ * Each copy inherits the shared simulator's random number state. Random
+ * numbers are only drawn for faults, at fault ticks that don't depend on
+ * mode, so all policies see the same faults (common random numbers). Any
+ * difference in the results is down to the policy alone.
+ *
+ * The per-policy simulators and their fleets all share one arena.
+ */
+class PolicyComparison {
+public:
+  PolicyComparison(const SimulatorConfig &config);
+  ~PolicyComparison();
+
+  PolicyComparison(const PolicyComparison &) = delete;
+  PolicyComparison &operator=(const PolicyComparison &) = delete;
+
+  /**
+   * @class PolicyComparison
+   * @brief Run a complete simulation for every policy.
+   * @param duration_ms Sim time, in milliseconds
+   */
+  void simulate(long long duration_ms);
+
+  /**
+   * @class PolicyComparison
+   * @brief Tick at which the policies diverged, or -1 if they never did.
+   */
+  int split_tick() const { return m_split_tick; }
+
+  /**
+   * @class PolicyComparison
+   * @brief Get the simulator that ran a given policy.
+   * @param policy The charger policy
+   */
+  const Simulator &variant(ChargerPolicy policy) const {
+    return *m_variants[policy];
+  }
+
+  /**
+   * @class PolicyComparison
+   * @brief Output CSV report comparing fleet statistics for each policy.
+   * @param out Stream to write the report to
+   */
+  void report_policy_stats(std::ostream &out = std::cout);
+
+private:
+  Simulator m_shared; /** Runs on behalf of all policies until they split */
+  int m_split_tick;   /** Tick at which the policies diverged */
+  Arena m_arena;      /** Memory for the per-policy simulators */
+
+  /** One simulator per policy, created when the policies diverge */
+  Simulator *m_variants[MAX_CHARGER_POLICIES] = {};
+
+  /**
+   * @class PolicyComparison
+   * @brief Copy the shared simulator once per policy.
+   */
+  void split();
+};
+
+#endif /* POLICY_COMPARISON_H */
@@ -0,0 +1,55 @@
+/**
+ * @file rng.cpp
+ * @brief Random number generator implementation.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "rng.hpp"
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Separation between the front and rear indices (glibc SEP_3). */
+constexpr int RNG_SEPARATION = 3;
+
+/** @brief Outputs discarded after seeding, to decorrelate from the seed. */
+constexpr int RNG_DISCARD = 10 * RNG_STATE_LEN;
+
+/*****************************************************************
+ * Member function definitions
+ *****************************************************************/
+
+/**
+ * @class Rng
+ * @brief Reset the generator, equivalent to srand(seed).
+ * @param seed Seed for the random sequence
+ */
+void Rng::seed_state(unsigned int seed) {
+  if (seed == 0) {
+    seed = 1;
+  }
+
+  // Park-Miller minimal standard generator, via Schrage's method to avoid
+  // overflowing 32 bits
+  m_state[0] = (int32_t)seed;
+  for (int i = 1; i < RNG_STATE_LEN; i++) {
+    int32_t hi = m_state[i - 1] / 127773;
+    int32_t lo = m_state[i - 1] % 127773;
+    int32_t word = 16807 * lo - 2836 * hi;
+    if (word < 0) {
+      word += 2147483647;
+    }
+    m_state[i] = word;
+  }
+
+  m_front = RNG_SEPARATION;
+  m_rear = 0;
+
+  for (int i = 0; i < RNG_DISCARD; i++) {
+    next();
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file rng.hpp
+ * @brief Random number generator definition.
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include <cstdint>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Largest value returned by Rng::next() (same as glibc RAND_MAX). */
+constexpr int RNG_MAX = 2147483647;
+
+/** @brief Words of generator state (glibc TYPE_3). */
+constexpr int RNG_STATE_LEN = 31;
+
+/*****************************************************************
+ * Class definitions
+ *****************************************************************/
+
+/**
+ * @class Rng
+ * @brief Random number generator owned by a single simulator.
+ *
+ * Produces exactly the same sequence as glibc's srand()/rand() for a given
+ * seed, so existing seeds still reproduce the same simulations. The difference
+ * is that the state lives in the object rather than in libc: copying an Rng
+ * forks the stream, and both copies will produce the same numbers from then
+ * on. That is what lets multiple simulator variants share common random
+ * numbers.
+ */
+class Rng {
+public:
+  Rng(unsigned int seed = 1) { seed_state(seed); }
+
+  /**
+   * @class Rng
+   * @brief Reset the generator, equivalent to srand(seed).
+   * @param seed Seed for the random sequence
+   */
+  void seed_state(unsigned int seed);
+
+  /**
+   * @class Rng
+   * @brief Get the next random number in [0, RNG_MAX], equivalent to rand().
+   */
+  int next() {
+    uint32_t *state = (uint32_t *)m_state;
+    state[m_front] += state[m_rear];
+    int result = (int)(state[m_front] >> 1);
+
+    if (++m_front >= RNG_STATE_LEN) {
+      m_front = 0;
+    }
+    if (++m_rear >= RNG_STATE_LEN) {
+      m_rear = 0;
+    }
+
+    return result;
+  }
+
+  /**
+   * @class Rng
+   * @brief Get the next random number scaled to [0, 1].
+   */
+  double uniform() { return (double)next() / RNG_MAX; }
+
+private:
+  int32_t m_state[RNG_STATE_LEN]; /** Additive feedback state */
+  int m_front;                    /** Index of the word updated next */
+  int m_rear;                     /** Index of the lagged word */
+};
+
+#endif /* RNG_H */
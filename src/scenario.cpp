@@ -0,0 +1,196 @@
+/**
+ * @file scenario.cpp
+ * @brief Scenario loading and running.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "scenario.hpp"
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Print a scenario file error to stderr.
+ * @param path Path to the scenario file
+ * @param line_num Line the error is on
+ * @param message What went wrong
+ * @return false, for convenience
+ */
+static bool scenario_error(const char *path, int line_num,
+                           const std::string &message) {
+  std::cerr << path << ":" << line_num << ": " << message << std::endl;
+  return false;
+}
+
+/**
+ * @brief Read a scenario file.
+ * @param path Path to the scenario file
+ * @param scenario Scenario to fill in
+ * @return true on success. On failure, the problem is printed to stderr.
+ */
+bool load_scenario(const char *path, Scenario *scenario) {
+  std::ifstream file(path);
+  if (!file) {
+    return scenario_error(path, 0, "cannot open file");
+  }
+
+  *scenario = Scenario();
+  SimulatorConfig *config = &scenario->config;
+  bool have_version = false;
+  std::string line;
+  int line_num = 0;
+
+  while (std::getline(file, line)) {
+    line_num++;
+
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+
+    std::istringstream fields(line);
+    std::string key;
+    if (!(fields >> key)) {
+      continue; // Blank line
+    }
+
+    if (!have_version && key != "version") {
+      return scenario_error(path, line_num, "'version' must come first");
+    }
+
+    bool ok = true;
+
+    if (key == "version") {
+      ok = (bool)(fields >> scenario->version);
+      if (ok && (scenario->version < 1 ||
+                 scenario->version > SCENARIO_VERSION)) {
+        return scenario_error(path, line_num,
+                              "unsupported version " +
+                                  std::to_string(scenario->version));
+      }
+      have_version = true;
+    } else if (key == "seed") {
+      ok = (bool)(fields >> config->seed);
+    } else if (key == "vehicles") {
+      ok = (fields >> config->vehicle_count) && config->vehicle_count >= 0;
+    } else if (key == "chargers") {
+      ok = (fields >> config->charger_count) && config->charger_count >= 0;
+    } else if (key == "duration_ms") {
+      ok = (fields >> scenario->duration_ms) && scenario->duration_ms >= 0;
+    } else if (key == "step_ms") {
+      ok = (fields >> config->step_ms) && config->step_ms > 0;
+    } else if (key == "type_weights") {
+      int total_weight = 0;
+      for (int i = 0; ok && i < MAX_AIRCRAFT_TYPES; i++) {
+        ok = (fields >> config->type_weights[i]) &&
+             config->type_weights[i] >= 0;
+        total_weight += config->type_weights[i];
+      }
+      ok = ok && total_weight > 0;
+    } else if (key == "charger_policy") {
+      std::string name;
+      ok = (bool)(fields >> name);
+      int i = 0;
+      while (i < MAX_CHARGER_POLICIES && name != charger_policy_str[i]) {
+        i++;
+      }
+      ok = ok && i < MAX_CHARGER_POLICIES;
+      config->charger_policy = (ChargerPolicy)i;
+    } else if (key == "range_prediction") {
+      ok = (bool)(fields >> config->range_prediction);
+    } else if (key == "environment") {
+      std::string env_path;
+      ok = (bool)(fields >> env_path);
+      if (ok && env_path[0] != '/') {
+        std::string dir(path);
+        size_t slash = dir.rfind('/');
+        if (slash != std::string::npos) {
+          env_path = dir.substr(0, slash + 1) + env_path;
+        }
+      }
+      if (ok && !set_scenario_environment(env_path.c_str(), scenario)) {
+        return scenario_error(path, line_num, "bad environment file");
+      }
+    } else {
+      return scenario_error(path, line_num, "unknown key '" + key + "'");
+    }
+
+    std::string extra;
+    if (!ok || (fields >> extra)) {
+      return scenario_error(path, line_num, "bad value for '" + key + "'");
+    }
+  }
+
+  if (!have_version) {
+    return scenario_error(path, line_num, "missing 'version'");
+  }
+
+  return true;
+}
+
+/**
+ * @brief Run a scenario and write the full set of reports used for
+ * regression testing.
+ * @param scenario The scenario to run
+ * @param out Stream to write the reports to
+ */
+void run_scenario(const Scenario &scenario, std::ostream &out) {
+  Simulator sim(scenario.config);
+  sim.simulate(scenario.duration_ms);
+  report_scenario(scenario, sim, out);
+}
+
+/**
+ * @brief Write the full set of reports used for regression testing for a
+ * scenario that has been run.
+ * @param scenario The scenario
+ * @param sim Simulator holding the fleet after the run
+ * @param out Stream to write the reports to
+ */
+void report_scenario(const Scenario &scenario, Simulator &sim,
+                     std::ostream &out) {
+  // The window the reports cover, which for a resumed run also holds the
+  // fleet image's ticks unless its stats were reset
+  long long start_ms = (long long)sim.stats_start_tick() * sim.step_ms();
+  out << "Simulated for "
+      << (long long)sim.ticks() * sim.step_ms() - start_ms << "ms";
+  if (start_ms > 0) {
+    out << " from " << start_ms << "ms";
+  }
+  out << std::endl;
+
+  sim.report_vehicle_type_stats(out);
+  sim.report_dispatch_stats(out);
+
+  if (scenario.environment) {
+    sim.report_environment_stats(out);
+  }
+
+  if (scenario.config.vehicle_count <= SCENARIO_MODE_REPORT_MAX_VEHICLES) {
+    sim.report_time_per_mode(out);
+  }
+}
+
+/**
+ * @brief Load an environment file and attach it to a scenario.
+ * @param path Path to the environment file
+ * @param scenario Scenario to attach it to
+ * @return true on success. On failure, the problem is printed to stderr.
+ */
+bool set_scenario_environment(const char *path, Scenario *scenario) {
+  auto environment = std::make_shared<Environment>();
+  if (!load_environment(path, environment.get())) {
+    return false;
+  }
+
+  scenario->environment = environment;
+  scenario->config.environment = environment.get();
+  return true;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file scenario.hpp
+ * @brief Scenario definition and file format.
+ */
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "common.hpp"
+#include "environment.hpp"
+#include "simulator.hpp"
+#include <iostream>
+#include <memory>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Newest scenario file version this build can read. */
+constexpr int SCENARIO_VERSION = 1;
+
+/** @brief Default simulated time (ms). */
+constexpr long long DEFAULT_DURATION_MS = MS_PER_HOUR * 3LL;
+
+/** @brief Largest fleet to include per-vehicle reports for in the
+ * regression report; bigger fleets only get per-type reports. */
+constexpr int SCENARIO_MODE_REPORT_MAX_VEHICLES = 100;
+
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/**
+ * @brief A complete, reproducible simulation workload.
+ *
+ * Scenario files are plain text, one `key value` pair per line, with `#`
+ * comments. `version` must come first. Keys that are left out keep their
+ * defaults. For example:
+ *
+ *   version 1
+ *   seed 12452
+ *   vehicles 20
+ *   chargers 3
+ *   duration_ms 10800000
+ *   step_ms 100
+ *   type_weights 1 1 1 1 1
+ *   charger_policy FIFO
+ *   range_prediction 0
+ *   environment degraded_day.env
+ *
+ * The environment path is relative to the scenario file (see
+ * environment.hpp for its format). config.environment points into
+ * `environment`, which copies of the scenario share.
+ */
+struct Scenario {
+  int version = SCENARIO_VERSION;              /** File format version */
+  SimulatorConfig config;                      /** Simulator setup */
+  long long duration_ms = DEFAULT_DURATION_MS; /** Simulated time (ms) */
+  std::shared_ptr<const Environment> environment; /** Weather and airspace
+                                                     limits, if any */
+};
+
+/*****************************************************************
+ * Function declarations
+ *****************************************************************/
+
+/**
+ * @brief Read a scenario file.
+ * @param path Path to the scenario file
+ * @param scenario Scenario to fill in
+ * @return true on success. On failure, the problem is printed to stderr.
+ */
+bool load_scenario(const char *path, Scenario *scenario);
+
+/**
+ * @brief Run a scenario and write the full set of reports used for
+ * regression testing.
+ * @param scenario The scenario to run
+ * @param out Stream to write the reports to
+ */
+void run_scenario(const Scenario &scenario, std::ostream &out);
+
+/**
+ * @brief Write the full set of reports used for regression testing for a
+ * scenario that has been run.
+ * @param scenario The scenario
+ * @param sim Simulator holding the fleet after the run
+ * @param out Stream to write the reports to
+ */
+void report_scenario(const Scenario &scenario, Simulator &sim,
+                     std::ostream &out);
+
+/**
+ * @brief Load an environment file and attach it to a scenario.
+ * @param path Path to the environment file
+ * @param scenario Scenario to attach it to
+ * @return true on success. On failure, the problem is printed to stderr.
+ */
+bool set_scenario_environment(const char *path, Scenario *scenario);
+
+#endif /* SCENARIO_H */
@@ -13,9 +13,23 @@
 #include "simulator.hpp"
 #include "aircraft.hpp"
 #include "common.hpp"
+#include "state_hash.hpp"
+#include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <fcntl.h>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+static_assert(std::is_trivially_copyable<Aircraft>::value &&
+                  std::is_trivially_destructible<Aircraft>::value,
+              "Aircraft must be plain data to live in arena memory");
 
 /*****************************************************************
  * Macros
@@ -24,6 +38,146 @@
 /** @brief Show statistics for all vehicles at every sim step */
 #define DEBUG_SIM_STEP (false)
 
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/** @brief Identifies a fleet image file. */
+static const char FLEET_IMAGE_MAGIC[8] = {'E', 'V', 'T', 'O',
+                                          'L', 'F', 'L', 'T'};
+
+/** @brief Start of a fleet image: everything but the fleet itself, which
+ * follows at fleet_offset as raw Aircraft. Images hold raw structs, so they
+ * only load into a build with the same layouts (checked by size). */
+struct FleetImageHeader {
+  char magic[8];             /** FLEET_IMAGE_MAGIC */
+  uint32_t version;          /** FLEET_IMAGE_VERSION */
+  uint32_t header_bytes;     /** sizeof(FleetImageHeader) */
+  uint32_t aircraft_bytes;   /** sizeof(Aircraft) */
+  int32_t vehicle_count;     /** Aircraft in the fleet */
+  uint64_t fleet_offset;     /** Start of the fleet in the file */
+  int32_t charger_count;     /** Available chargers */
+  int32_t chargers_in_use;   /** Chargers actively being used */
+  int32_t waiting;           /** Aircraft waiting for a charger */
+  int32_t ticks;             /** Elapsed simulation ticks */
+  int32_t stats_start_tick;  /** Tick the stats were last reset at */
+  int32_t step_ms;           /** Time step interval (ms) */
+  int32_t charger_policy;    /** Charger allocation */
+  int32_t range_prediction;  /** Check range before dispatching */
+  int32_t defer_contested;   /** Pause at contested allocations */
+  uint64_t env_checksum;     /** Environment::checksum(), 0 for still air */
+  int32_t region_flying[ENV_MAX_REGIONS]; /** Aircraft flying per region */
+  RangeTable range_table[MAX_AIRCRAFT_TYPES]; /** Per-type trip params */
+  Rng rng;                   /** Random state */
+};
+
+static_assert(std::is_trivially_copyable<FleetImageHeader>::value,
+              "Fleet image header must be plain data");
+static_assert(sizeof(FleetImageHeader) <= FLEET_IMAGE_ALIGN,
+              "Fleet image header must fit before the fleet");
+
+/*****************************************************************
+ * Globals
+ *****************************************************************/
+
+const char *charger_policy_str[] = {
+    "FIFO",
+    "LowestEnergy",
+    "ShortestCharge",
+    "EarliestArrival",
+    "Reservation",
+};
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Build a config with the given fleet and the default everything else.
+ * @param vehicle_count Number of vehicles in the simulator.
+ * @param seed Seed for the simulator's random numbers.
+ * @param policy Charger allocation policy.
+ */
+static SimulatorConfig default_config(int vehicle_count, unsigned int seed,
+                                      ChargerPolicy policy) {
+  SimulatorConfig config;
+  config.vehicle_count = vehicle_count;
+  config.seed = seed;
+  config.charger_policy = policy;
+  return config;
+}
+
+/**
+ * @brief Add one set of per-type statistics into another.
+ * @param into Array of MAX_AIRCRAFT_TYPES entries to add to
+ * @param from Array of MAX_AIRCRAFT_TYPES entries to add
+ */
+void merge_type_stats(TypeStats *into, const TypeStats *from) {
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    into[i].vehicle_count += from[i].vehicle_count;
+    into[i].flights += from[i].flights;
+    into[i].flight_ticks += from[i].flight_ticks;
+    into[i].chg_ticks += from[i].chg_ticks;
+    into[i].chg_sessions += from[i].chg_sessions;
+    into[i].faults += from[i].faults;
+    into[i].passenger_miles += from[i].passenger_miles;
+    into[i].flight_distance += from[i].flight_distance;
+  }
+}
+
+/**
+ * @brief Output CSV report of aggregate vehicle type statistics, per the
+ * problem description.
+ * @param stats Array of MAX_AIRCRAFT_TYPES entries
+ * @param step_ms Time step the stats were collected with (ms)
+ * @param out Stream to write the report to
+ */
+void report_type_stats(const TypeStats *stats, int step_ms,
+                       std::ostream &out) {
+  // CSV header
+  out << "VehicleType,VehicleCount,FlightTimePerFlight(Hours),DistPerFlight,"
+         "ChgSessionTime,"
+         "TotalFaults,TotalPassengerMiles"
+      << std::endl;
+
+  for (int i_type = 0; i_type < MAX_AIRCRAFT_TYPES; i_type++) {
+    const TypeStats *type_stats = &stats[i_type];
+    double total_flight_time =
+        (type_stats->flight_ticks * step_ms) / (double)MS_PER_HOUR;
+    double total_chg_time =
+        (type_stats->chg_ticks * step_ms) / (double)MS_PER_HOUR;
+
+    // Finally calculate the necessary statistics
+    double avg_flight_time;
+    double avg_flight_dist;
+    double avg_chg_time;
+
+    if (type_stats->flights > 0) {
+      avg_flight_time = total_flight_time / (double)type_stats->flights;
+    } else {
+      avg_flight_time = 0;
+    }
+
+    if (type_stats->flights > 0) {
+      avg_flight_dist =
+          type_stats->flight_distance / (double)type_stats->flights;
+    } else {
+      avg_flight_dist = 0;
+    }
+
+    if (type_stats->chg_sessions > 0) {
+      avg_chg_time = total_chg_time / (double)type_stats->chg_sessions;
+    } else {
+      avg_chg_time = 0;
+    }
+
+    out << aircraft_type_str[i_type] << "," << type_stats->vehicle_count << ","
+        << avg_flight_time << "," << avg_flight_dist << "," << avg_chg_time
+        << "," << type_stats->faults << "," << type_stats->passenger_miles
+        << std::endl;
+  }
+}
+
 /*****************************************************************
  * Member function definitions
  *****************************************************************/
@@ -31,40 +185,322 @@
 /**
  * @class Simulator
  * @brief Constructor for simulator.
- * @param vehicle_count Number of vehicles in the simulator.
+ * @param config Fleet, chargers, time step, seed and policies.
+ * @param arena Arena for per-run memory, or nullptr to allocate one.
  *
- * Initializes `m_vehicle_count` random aircraft.
+ * Initializes `m_vehicle_count` aircraft, with types drawn at random in
+ * proportion to the configured type weights.
  */
-Simulator::Simulator(int vehicle_count) {
-  if (vehicle_count > MAX_VEHICLES) {
-    vehicle_count = MAX_VEHICLES;
+Simulator::Simulator(const SimulatorConfig &config, Arena *arena)
+    : m_vehicle_count(config.vehicle_count),
+      m_charger_count(config.charger_count), m_step_ms(config.step_ms),
+      m_charger_policy(config.charger_policy),
+      m_range_prediction(config.range_prediction),
+      m_environment(config.environment), m_rng(config.seed) {
+  if (m_vehicle_count < 0) {
+    m_vehicle_count = 0;
+  }
+
+  m_vehicle_capacity = config.vehicle_capacity;
+  if (m_vehicle_capacity < m_vehicle_count) {
+    m_vehicle_capacity = m_vehicle_count;
+  }
+
+  if (!arena) {
+    m_own_arena = Arena(arena_bytes(m_vehicle_capacity));
+    arena = &m_own_arena;
   }
 
-  m_vehicle_count = vehicle_count;
+  m_arena = arena;
+  m_vehicles = m_arena->allocate_array<Aircraft>(m_vehicle_capacity);
+
+  build_range_table();
+
+  int total_weight = 0;
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    total_weight += config.type_weights[i];
+  }
 
   // Initialize random types of vehicles
   for (int i = 0; i < m_vehicle_count; i++) {
-    AircraftType random_type = (AircraftType)(rand() % MAX_AIRCRAFT_TYPES);
-
-    switch (random_type) {
-    case TYPE__ALPHA:
-      m_vehicles[i] = Alpha();
-      break;
-    case TYPE__BRAVO:
-      m_vehicles[i] = Bravo();
-      break;
-    case TYPE__CHARLIE:
-      m_vehicles[i] = Charlie();
-      break;
-    case TYPE__DELTA:
-      m_vehicles[i] = Delta();
-      break;
-    case TYPE__ECHO:
-      m_vehicles[i] = Echo();
-      break;
-    default:
-      break;
+    int roll = total_weight > 0 ? m_rng.next() % total_weight : 0;
+    int random_type = 0;
+
+    while (random_type < MAX_AIRCRAFT_TYPES - 1 &&
+           roll >= config.type_weights[random_type]) {
+      roll -= config.type_weights[random_type];
+      random_type++;
     }
+
+    new (&m_vehicles[i])
+        Aircraft(aircraft_prototype((AircraftType)random_type));
+  }
+
+  for (int i = 0; i < m_vehicle_count; i++) {
+    m_vehicles[i].m_sim_next_fault_tick =
+        m_vehicles[i].next_fault_tick(0, m_step_ms, m_rng);
+  }
+
+  // Spread the fleet evenly over the environment's regions
+  if (m_environment) {
+    for (int i = 0; i < m_vehicle_count; i++) {
+      m_vehicles[i].m_sim_region = i % m_environment->regions();
+    }
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Constructor for simulator with the default chargers and time step.
+ * @param vehicle_count Number of vehicles in the simulator.
+ * @param seed Seed for the simulator's random numbers.
+ * @param policy Charger allocation policy.
+ * @param arena Arena for per-run memory, or nullptr to allocate one.
+ */
+Simulator::Simulator(int vehicle_count, unsigned int seed, ChargerPolicy policy,
+                     Arena *arena)
+    : Simulator(default_config(vehicle_count, seed, policy), arena) {}
+
+/**
+ * @class Simulator
+ * @brief Copy constructor for simulator.
+ * @param other The simulator to copy, including its fleet and random state.
+ * @param arena Arena for per-run memory, or nullptr to allocate one.
+ */
+Simulator::Simulator(const Simulator &other, Arena *arena)
+    : m_vehicle_count(other.m_vehicle_count),
+      m_vehicle_capacity(other.m_vehicle_capacity),
+      m_charger_count(other.m_charger_count),
+      m_num_chargers_in_use(other.m_num_chargers_in_use),
+      m_num_waiting(other.m_num_waiting), m_ticks(other.m_ticks),
+      m_stats_start_tick(other.m_stats_start_tick),
+      m_step_ms(other.m_step_ms),
+      m_next_vehicle(other.m_next_vehicle),
+      m_charger_policy(other.m_charger_policy),
+      m_defer_contested(other.m_defer_contested),
+      m_allocation_pending(other.m_allocation_pending),
+      m_range_prediction(other.m_range_prediction),
+      m_environment(other.m_environment), m_env_row(other.m_env_row),
+      m_rng(other.m_rng) {
+  memcpy(m_range_table, other.m_range_table, sizeof(m_range_table));
+  memcpy(m_region_flying, other.m_region_flying, sizeof(m_region_flying));
+
+  if (!arena) {
+    m_own_arena = Arena(arena_bytes(m_vehicle_capacity));
+    arena = &m_own_arena;
+  }
+
+  m_arena = arena;
+  m_vehicles = m_arena->allocate_array<Aircraft>(m_vehicle_capacity);
+  memcpy((void *)m_vehicles, other.m_vehicles,
+         m_vehicle_count * sizeof(Aircraft));
+}
+
+/**
+ * @class Simulator
+ * @brief Arena space needed for a simulator's per-run memory: the fleet,
+ * and a state hash per aircraft if recording a hash trace.
+ * @param vehicle_count Number of vehicles the simulator has room for.
+ */
+size_t Simulator::arena_bytes(int vehicle_count) {
+  return vehicle_count * (sizeof(Aircraft) + sizeof(uint64_t)) + ARENA_ALIGN;
+}
+
+/**
+ * @brief Print a fleet image error to stderr.
+ * @return false, for convenience
+ */
+static bool image_error(const char *path, const char *message) {
+  std::cerr << path << ": " << message << std::endl;
+  return false;
+}
+
+/**
+ * @class Simulator
+ * @brief Save the complete simulator state (fleet, charger queue, random
+ * state, options) to a fleet image file, between ticks.
+ * @param path Path to the image file
+ * @return true on success. On failure, the problem is printed to stderr.
+ *
+ * The charger queue is the waiting aircraft in the fleet, so it comes along
+ * with the fleet. The environment is not saved, only its checksum; pass the
+ * same one to load_image().
+ *
+ * The image is written next to `path` and renamed over it, so a failed save
+ * leaves any existing image intact, and a simulator can save back to the
+ * image it was loaded from.
+ */
+bool Simulator::save_image(const char *path) const {
+  if (m_next_vehicle || m_allocation_pending) {
+    return image_error(path, "cannot save in the middle of a tick");
+  }
+
+  FleetImageHeader header;
+  memset((void *)&header, 0, sizeof(header));
+  memcpy(header.magic, FLEET_IMAGE_MAGIC, sizeof(header.magic));
+  header.version = FLEET_IMAGE_VERSION;
+  header.header_bytes = sizeof(FleetImageHeader);
+  header.aircraft_bytes = sizeof(Aircraft);
+  header.vehicle_count = m_vehicle_count;
+  header.fleet_offset = FLEET_IMAGE_ALIGN;
+  header.charger_count = m_charger_count;
+  header.chargers_in_use = m_num_chargers_in_use;
+  header.waiting = m_num_waiting;
+  header.ticks = m_ticks;
+  header.stats_start_tick = m_stats_start_tick;
+  header.step_ms = m_step_ms;
+  header.charger_policy = m_charger_policy;
+  header.range_prediction = m_range_prediction;
+  header.defer_contested = m_defer_contested;
+  header.env_checksum = m_environment ? m_environment->checksum() : 0;
+  memcpy(header.region_flying, m_region_flying, sizeof(m_region_flying));
+  memcpy((void *)header.range_table, m_range_table, sizeof(m_range_table));
+  header.rng = m_rng;
+
+  // The fleet may be mapped from the image being replaced, with pages not
+  // read in yet, so write a new file and swap it in rather than truncating
+  std::string temp_path = std::string(path) + ".tmp";
+  std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return image_error(temp_path.c_str(), "cannot open file");
+  }
+
+  // Pad the header out so the fleet is page aligned and can be mapped
+  std::vector<char> padding(FLEET_IMAGE_ALIGN - sizeof(header));
+  file.write((const char *)&header, sizeof(header));
+  file.write(padding.data(), padding.size());
+  file.write((const char *)m_vehicles, m_vehicle_count * sizeof(Aircraft));
+  file.close();
+
+  if (!file) {
+    remove(temp_path.c_str());
+    return image_error(path, "write failed");
+  }
+
+  if (rename(temp_path.c_str(), path) != 0) {
+    remove(temp_path.c_str());
+    return image_error(path, "cannot replace file");
+  }
+
+  return true;
+}
+
+/**
+ * @class Simulator
+ * @brief Replace this simulator's state with a saved fleet image.
+ * @param path Path to the image file
+ * @param environment The environment the image was saved with, if any
+ * @return true on success. On failure, the problem is printed to stderr
+ * and the simulator is unchanged.
+ *
+ * The fleet is mapped copy-on-write straight from the file rather than read
+ * in, so loading takes about as long for a million aircraft as for twenty;
+ * pages are faulted in as the first tick reaches them. The loaded fleet has
+ * no spare room for add_vehicle(). Hash tracing is left as it was.
+ */
+bool Simulator::load_image(const char *path, const Environment *environment) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return image_error(path, "cannot open file");
+  }
+
+  FleetImageHeader header;
+  struct stat file_stat;
+  bool read_ok = read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+                 fstat(fd, &file_stat) == 0;
+
+  const char *problem = nullptr;
+  if (!read_ok ||
+      memcmp(header.magic, FLEET_IMAGE_MAGIC, sizeof(header.magic))) {
+    problem = "not a fleet image";
+  } else if (header.version != FLEET_IMAGE_VERSION) {
+    problem = "unsupported fleet image version";
+  } else if (header.header_bytes != sizeof(FleetImageHeader) ||
+             header.aircraft_bytes != sizeof(Aircraft)) {
+    problem = "fleet image was saved by an incompatible build";
+  } else if (header.vehicle_count < 0 || header.step_ms <= 0 ||
+             header.fleet_offset % FLEET_IMAGE_ALIGN ||
+             header.charger_policy < 0 ||
+             header.charger_policy >= MAX_CHARGER_POLICIES ||
+             (uint64_t)file_stat.st_size <
+                 header.fleet_offset +
+                     (uint64_t)header.vehicle_count * sizeof(Aircraft)) {
+    problem = "corrupt fleet image";
+  } else if (header.env_checksum !=
+             (environment ? environment->checksum() : 0)) {
+    problem = "fleet image was saved with a different environment";
+  }
+
+  Arena fleet;
+  if (!problem &&
+      !fleet.map_file(fd, header.fleet_offset,
+                      header.vehicle_count * sizeof(Aircraft))) {
+    problem = "cannot map fleet";
+  }
+
+  close(fd);
+  if (problem) {
+    return image_error(path, problem);
+  }
+
+  m_vehicle_count = header.vehicle_count;
+  m_vehicle_capacity = header.vehicle_count;
+  m_charger_count = header.charger_count;
+  m_num_chargers_in_use = header.chargers_in_use;
+  m_num_waiting = header.waiting;
+  m_ticks = header.ticks;
+  m_stats_start_tick = header.stats_start_tick;
+  m_step_ms = header.step_ms;
+  m_next_vehicle = 0;
+  m_charger_policy = (ChargerPolicy)header.charger_policy;
+  m_defer_contested = header.defer_contested;
+  m_allocation_pending = false;
+  m_range_prediction = header.range_prediction;
+  memcpy(m_range_table, header.range_table, sizeof(m_range_table));
+  m_environment = environment;
+  m_env_row = nullptr;
+  memcpy(m_region_flying, header.region_flying, sizeof(m_region_flying));
+  m_rng = header.rng;
+
+  m_own_arena = static_cast<Arena &&>(fleet);
+  m_arena = &m_own_arena;
+  m_vehicles = (Aircraft *)m_own_arena.base();
+  m_vehicle_hashes = nullptr;
+
+  if (m_hash_trace) {
+    set_hash_trace(m_hash_trace, m_hash_energy);
+  }
+  return true;
+}
+
+/**
+ * @class Simulator
+ * @brief Zero the fleet's counters so reports only cover ticks from now on,
+ * e.g. to leave a warm-up loaded with load_image() out of them.
+ *
+ * Only the counters are reset. Each aircraft keeps its mode, battery, trip
+ * and place in the charger queue, so the run carries on exactly as before;
+ * a trip or charge already under way counts in full when it completes.
+ */
+void Simulator::reset_stats() {
+  for (int i = 0; i < m_vehicle_count; i++) {
+    Aircraft *vehicle = &m_vehicles[i];
+    memset(vehicle->m_mode_ticks, 0, sizeof(vehicle->m_mode_ticks));
+    vehicle->m_sim_total_miles = 0.0;
+    vehicle->m_sim_total_passenger_mi = 0.0;
+    vehicle->m_sim_total_num_faults = 0;
+    vehicle->m_sim_trips_started = 0;
+    vehicle->m_sim_charging_sessions = 0;
+    vehicle->m_sim_trips_stranded = 0;
+    vehicle->m_sim_trips_deferred = 0;
+    vehicle->m_sim_ticks_held = 0;
+  }
+
+  m_stats_start_tick = m_ticks;
+
+  // The counts are part of each aircraft's hash
+  if (m_hash_trace) {
+    set_hash_trace(m_hash_trace, m_hash_energy);
   }
 }
 
@@ -73,24 +509,239 @@ Simulator::Simulator(int vehicle_count) {
  * @brief Run a complete simulation.
  * @param duration_ms Sim time, in milliseconds
  */
-void Simulator::simulate(int duration_ms) {
-  std::cout << "Simulating for " << duration_ms << "ms" << std::endl;
-
-  for (int time = 0; time < duration_ms; time += m_step_ms) {
+void Simulator::simulate(long long duration_ms) {
+  for (long long time = 0; time < duration_ms; time += m_step_ms) {
 #if DEBUG_SIM_STEP
     std::cout << "----------------------" << std::endl;
     std::cout << "t = " << time << "ms" << std::endl;
 #endif
 
-    for (int i = 0; i < m_vehicle_count; i++) {
-      update_aircraft(&m_vehicles[i]);
+    step();
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Run (or finish running) a single tick of the simulation.
+ * @return false if the tick was paused at a deferred charger allocation,
+ * true once the tick is complete.
+ *
+ * A paused tick picks up again from the vehicle after the one that paused it.
+ */
+bool Simulator::step() {
+  if (m_environment) {
+    m_env_row = m_environment->row((long long)m_ticks * m_step_ms);
+  }
+
+  for (int i = m_next_vehicle; i < m_vehicle_count; i++) {
+    Aircraft *vehicle = &m_vehicles[i];
+    AircraftMode mode = vehicle->m_sim_mode;
+    int faults = vehicle->m_sim_total_num_faults;
+    double energy = vehicle->m_sim_rem_energy;
+
+    update_aircraft(vehicle);
+
+    // Trips and charging sessions only ever start with a change of mode
+    if (m_hash_trace &&
+        (vehicle->m_sim_mode != mode ||
+         vehicle->m_sim_total_num_faults != faults ||
+         (m_hash_energy && vehicle->m_sim_rem_energy != energy))) {
+      rehash(i);
+    }
 #if DEBUG_SIM_STEP
-      report_step(&m_vehicles[i]);
+    report_step(&m_vehicles[i]);
 #endif
+
+    if (m_allocation_pending) {
+      m_next_vehicle = i + 1;
+      return false;
+    }
+  }
+
+  m_next_vehicle = 0;
+  m_ticks++;
+
+  if (m_hash_trace) {
+    m_hash_trace->push_back(m_state_hash);
+  }
+
+  return true;
+}
+
+/**
+ * @class Simulator
+ * @brief vehicle_state_hash() (and vehicle_energy_hash(), if hashing
+ * energy) for one aircraft in the fleet.
+ * @param index Index of vehicle in m_vehicles
+ */
+uint64_t Simulator::vehicle_hash(int index) const {
+  const Aircraft *vehicle = &m_vehicles[index];
+  uint64_t hash = vehicle_state_hash(index, vehicle->m_sim_mode,
+                                     vehicle->m_sim_trips_started,
+                                     vehicle->m_sim_charging_sessions,
+                                     vehicle->m_sim_total_num_faults);
+
+  if (m_hash_energy) {
+    hash += vehicle_energy_hash(index, vehicle->m_sim_rem_energy);
+  }
+
+  return hash;
+}
+
+/**
+ * @class Simulator
+ * @brief Update the state hash after an aircraft's mode or counts change.
+ * @param index Index of vehicle in m_vehicles
+ */
+void Simulator::rehash(int index) {
+  uint64_t hash = vehicle_hash(index);
+
+  m_state_hash += hash - m_vehicle_hashes[index];
+  m_vehicle_hashes[index] = hash;
+}
+
+/**
+ * @class Simulator
+ * @brief Record state_hash() at the end of every tick from now on.
+ * @param trace Vector to append a hash per tick to, or nullptr to stop.
+ * @param energy Also hash each aircraft's battery energy
+ *
+ * The per-aircraft hashes come from the arena, the first time only. A
+ * loaded fleet image's arena is just the mapped fleet, so the fleet moves to
+ * a new arena with room for them.
+ */
+void Simulator::set_hash_trace(std::vector<uint64_t> *trace, bool energy) {
+  m_hash_trace = trace;
+  m_hash_energy = trace && energy;
+  m_state_hash = 0;
+
+  if (m_hash_trace && !m_vehicle_hashes) {
+    try {
+      m_vehicle_hashes = m_arena->allocate_array<uint64_t>(m_vehicle_capacity);
+    } catch (const std::bad_alloc &) {
+      if (m_arena != &m_own_arena || !grow_fleet(m_vehicle_capacity)) {
+        throw;
+      }
     }
+  }
 
-    m_ticks++;
+  if (m_hash_trace) {
+    for (int i = 0; i < m_vehicle_count; i++) {
+      m_vehicle_hashes[i] = vehicle_hash(i);
+      m_state_hash += m_vehicle_hashes[i];
+    }
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Hash of the fleet's discrete state: the sum of
+ * vehicle_state_hash() over the fleet, plus vehicle_energy_hash() if the
+ * hash trace includes energy.
+ */
+uint64_t Simulator::state_hash() const {
+  uint64_t hash = 0;
+
+  for (int i = 0; i < m_vehicle_count; i++) {
+    hash += vehicle_hash(i);
+  }
+
+  return hash;
+}
+
+/**
+ * @class Simulator
+ * @brief Add an aircraft to the end of the fleet, between ticks.
+ * @param vehicle The aircraft to add
+ * @return false if the fleet is at capacity and there's no memory to grow it
+ */
+bool Simulator::add_vehicle(const Aircraft &vehicle) {
+  if (m_vehicle_count >= m_vehicle_capacity &&
+      !grow_fleet(m_vehicle_capacity * 2 + 1)) {
+    return false;
+  }
+
+  m_vehicles[m_vehicle_count++] = vehicle;
+  m_num_waiting += (MODE__WAITING_TO_CHARGE == vehicle.m_sim_mode);
+
+  if (m_hash_trace) {
+    m_vehicle_hashes[m_vehicle_count - 1] = vehicle_hash(m_vehicle_count - 1);
+    m_state_hash += m_vehicle_hashes[m_vehicle_count - 1];
   }
+  return true;
+}
+
+/**
+ * @class Simulator
+ * @brief Move the fleet (and its state hashes, if recording) to bigger
+ * arrays.
+ * @param capacity Number of aircraft the new arrays have room for
+ * @return false if there's no memory for them
+ *
+ * A simulator that owns its arena swaps it for a bigger one. One built in a
+ * caller's arena takes the new arrays from that arena, and the old ones
+ * stay allocated until the caller resets it.
+ */
+bool Simulator::grow_fleet(int capacity) {
+  Arena grown;
+  Arena *arena = m_arena;
+  Aircraft *vehicles;
+  uint64_t *hashes = nullptr;
+
+  try {
+    if (m_arena == &m_own_arena) {
+      grown = Arena(arena_bytes(capacity));
+      arena = &grown;
+    }
+    vehicles = arena->allocate_array<Aircraft>(capacity);
+    if (m_hash_trace) {
+      hashes = arena->allocate_array<uint64_t>(capacity);
+    }
+  } catch (const std::bad_alloc &) {
+    return false;
+  }
+
+  memcpy((void *)vehicles, m_vehicles, m_vehicle_count * sizeof(Aircraft));
+  if (hashes && m_vehicle_hashes) {
+    memcpy(hashes, m_vehicle_hashes, m_vehicle_count * sizeof(uint64_t));
+  }
+  if (m_arena == &m_own_arena) {
+    m_own_arena = static_cast<Arena &&>(grown);
+  }
+
+  m_vehicles = vehicles;
+  m_vehicle_hashes = hashes;
+  m_vehicle_capacity = capacity;
+  return true;
+}
+
+/**
+ * @class Simulator
+ * @brief Remove the waiting aircraft that the charger policy would charge
+ * next from the fleet, between ticks.
+ * @param vehicle Where to put the removed aircraft
+ * @return false if no aircraft is waiting
+ *
+ * The aircraft after it each move down one place, so the rest of the fleet
+ * keeps its order (and with it, the update order and charger tie-breaks).
+ */
+bool Simulator::take_next_to_charge(Aircraft *vehicle) {
+  int index = find_next_to_charge(m_charger_policy);
+  if (index < 0) {
+    return false;
+  }
+
+  *vehicle = m_vehicles[index];
+  m_vehicle_count--;
+  memmove((void *)&m_vehicles[index], &m_vehicles[index + 1],
+          (m_vehicle_count - index) * sizeof(Aircraft));
+  m_num_waiting--;
+
+  // Hashes depend on fleet position, so everything after `index` changed
+  if (m_hash_trace) {
+    set_hash_trace(m_hash_trace, m_hash_energy);
+  }
+  return true;
 }
 
 /**
@@ -99,25 +750,44 @@ void Simulator::simulate(int duration_ms) {
  * @param index Index of vehicle in m_vehicles
  */
 void Simulator::update_aircraft(Aircraft *vehicle) {
+  bool was_waiting = MODE__WAITING_TO_CHARGE == vehicle->m_sim_mode;
   vehicle->m_mode_ticks[vehicle->m_sim_mode]++;
-  vehicle->roll_for_fault(m_step_ms);
+
+  // Also catches up on a fault due while the aircraft was between shards
+  if (vehicle->m_sim_next_fault_tick <= m_ticks) {
+    vehicle->m_sim_total_num_faults++;
+    vehicle->m_sim_next_fault_tick =
+        vehicle->next_fault_tick(m_ticks + 1, m_step_ms, m_rng);
+  }
 
   // State machine for aircraft
   if (MODE__IDLE == vehicle->m_sim_mode) {
-    if (vehicle->m_sim_rem_energy <= 0) {
+    // A held charger is used at the first stop, instead of another trip
+    if (vehicle->m_sim_rem_energy <= 0 || vehicle->m_sim_charger_held) {
       vehicle->m_sim_mode = MODE__WAITING_TO_CHARGE;
     } else {
-      // @TODO Vary passenger count, trip length for a more realistic sim
-      vehicle->start_trip(vehicle->m_max_passenger_cnt,
-                          vehicle->m_max_trip_len);
+      dispatch_trip(vehicle);
     }
   } else if (MODE__FLYING == vehicle->m_sim_mode) {
-    vehicle->fly(m_step_ms);
+    if (m_environment) {
+      double speed;
+      double energy_per_mile;
+      flight_conditions(vehicle, &speed, &energy_per_mile);
+      vehicle->fly(m_step_ms, speed, energy_per_mile);
+
+      if (MODE__FLYING != vehicle->m_sim_mode) {
+        m_region_flying[vehicle->m_sim_region]--;
+      }
+    } else {
+      vehicle->fly(m_step_ms);
+    }
   } else if (MODE__CHARGING == vehicle->m_sim_mode) {
     vehicle->charge(m_step_ms);
   } else if (MODE__WAITING_TO_CHARGE == vehicle->m_sim_mode) {
-    if (m_num_chargers_in_use < m_charger_count) {
-      m_num_chargers_in_use++;
+    bool held = vehicle->m_sim_charger_held;
+    if (held || m_num_chargers_in_use < m_charger_count) {
+      m_num_chargers_in_use += !held; // A held charger is already in use
+      vehicle->m_sim_charger_held = false;
       vehicle->m_sim_charging_sessions++;
       vehicle->m_sim_ticks_waiting_chg = 0;
       vehicle->m_sim_mode = MODE__CHARGING;
@@ -127,59 +797,425 @@ void Simulator::update_aircraft(Aircraft *vehicle) {
   } else if (MODE__CHARGE_COMPLETE == vehicle->m_sim_mode) {
     m_num_chargers_in_use--;
     vehicle->m_sim_mode = MODE__IDLE;
-    allocate_charger_fifo();
+    allocate_charger();
+  }
+
+  m_num_waiting +=
+      (MODE__WAITING_TO_CHARGE == vehicle->m_sim_mode) - was_waiting;
+}
+
+/**
+ * @class Simulator
+ * @brief Ground speed and energy use for an aircraft in this tick's
+ * conditions.
+ * @param vehicle The aircraft
+ * @param speed Set to the ground speed (mph)
+ * @param energy_per_mile Set to the energy used per ground mile (kWh/mile)
+ *
+ * The aircraft holds its cruise airspeed and power, so a headwind cuts its
+ * ground speed and stretches the energy per ground mile to match. Cold cuts
+ * usable battery energy, modelled as extra energy use per degree.
+ */
+void Simulator::flight_conditions(const Aircraft *vehicle, double *speed,
+                                  double *energy_per_mile) const {
+  const EnvCell &cell = m_env_row[vehicle->m_sim_region];
+  double cruise = vehicle->m_cruise_speed;
+
+  // Still, mild air is exactly the same as flying without an environment
+  *speed = cruise;
+  *energy_per_mile = vehicle->m_energy_use_cruise;
+
+  if (cell.headwind_mph != 0) {
+    *speed = cruise - cell.headwind_mph;
+    if (*speed < cruise * ENV_MIN_GROUND_SPEED) {
+      *speed = cruise * ENV_MIN_GROUND_SPEED;
+    }
+    *energy_per_mile = vehicle->m_energy_use_cruise * cruise / *speed;
+  }
+
+  if (cell.temperature_c < ENV_COLD_TEMP_C) {
+    *energy_per_mile *= 1 + ENV_COLD_PENALTY_PER_C *
+                                (ENV_COLD_TEMP_C - cell.temperature_c);
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Send an idle aircraft on a trip, or to charge if it can't make it.
+ * @param vehicle The aircraft to dispatch
+ *
+ * With range prediction on, trips are capped at what a full battery can fly,
+ * and only accepted if the remaining battery covers them. Both checks come
+ * from the precomputed range table, so this is a single comparison.
+ *
+ * With an environment, aircraft are held on the ground while their region's
+ * airspace is full, and range (and the trip cap) is predicted for the
+ * conditions at dispatch.
+ */
+void Simulator::dispatch_trip(Aircraft *vehicle) {
+  const RangeTable *range = &m_range_table[vehicle->m_type];
+  double trip_len = vehicle->m_max_trip_len;
+  double predicted_len = range->trip_len;
+  double trip_energy = range->trip_energy;
+  double miles_per_tick = range->miles_per_tick;
+
+  if (m_environment) {
+    int region = vehicle->m_sim_region;
+    if (m_region_flying[region] >= m_env_row[region].airspace_capacity) {
+      vehicle->m_sim_ticks_held++;
+      return;
+    }
+
+    double speed;
+    double energy_per_mile;
+    flight_conditions(vehicle, &speed, &energy_per_mile);
+
+    miles_per_tick = speed * (m_step_ms / (double)MS_PER_HOUR);
+    double energy_per_tick =
+        energy_per_mile * speed * (m_step_ms / (double)MS_PER_HOUR);
+    int trip_ticks = (int)(range->trip_len / miles_per_tick) + 1;
+
+    // As in the range table, but for this tick's conditions. Otherwise a
+    // headwind can ask for more than a full battery and the trip is never
+    // accepted.
+    int full_range_ticks =
+        (int)((vehicle->m_max_battery_cap - RANGE_RESERVE_KWH) /
+              energy_per_tick);
+    if (trip_ticks > full_range_ticks) {
+      trip_ticks = full_range_ticks;
+      predicted_len = (full_range_ticks - 1) * miles_per_tick;
+    }
+
+    trip_energy = trip_ticks * energy_per_tick + RANGE_RESERVE_KWH;
+  }
+
+  if (m_range_prediction) {
+    if (vehicle->m_sim_rem_energy < trip_energy) {
+      vehicle->m_sim_trips_deferred++;
+      vehicle->m_sim_mode = MODE__WAITING_TO_CHARGE;
+      return;
+    }
+
+    trip_len = predicted_len;
+  }
+
+  // @TODO Vary passenger count, trip length for a more realistic sim
+  vehicle->start_trip(vehicle->m_max_passenger_cnt, trip_len);
+
+  if (m_environment) {
+    m_region_flying[vehicle->m_sim_region]++;
   }
+
+  // Estimate when the trip will end, for earliest-arrival allocation, and
+  // book a charger for then if it won't leave enough for another trip
+  vehicle->m_sim_est_arrival_tick =
+      m_ticks + (int)std::ceil(trip_len / miles_per_tick);
+  vehicle->m_sim_charge_booked =
+      vehicle->m_sim_rem_energy < 2 * trip_energy;
 }
 
 /**
  * @class Simulator
- * @brief Find the next aircraft to charge, and charge it. FIFO waiting queue.
+ * @brief Fill in m_range_table for the current time step.
+ *
+ * fly() drains the battery a whole tick at a time, and a trip is only
+ * complete at the end of the tick that reaches its length. A trip of L miles
+ * therefore takes at most floor(L / miles_per_tick) + 1 ticks, and needs that
+ * many ticks' worth of battery.
  */
-void Simulator::allocate_charger_fifo() {
+void Simulator::build_range_table() {
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    const Aircraft &aircraft = aircraft_prototype((AircraftType)i);
+    RangeTable *range = &m_range_table[i];
+
+    range->miles_per_tick =
+        aircraft.m_cruise_speed * (m_step_ms / (double)MS_PER_HOUR);
+    range->energy_per_tick = aircraft.m_energy_use_cruise *
+                             aircraft.m_cruise_speed *
+                             (m_step_ms / (double)MS_PER_HOUR);
+
+    int full_range_ticks = (int)((aircraft.m_max_battery_cap -
+                                  RANGE_RESERVE_KWH) /
+                                 range->energy_per_tick);
+    int trip_ticks =
+        (int)(aircraft.m_max_trip_len / range->miles_per_tick) + 1;
+
+    if (trip_ticks <= full_range_ticks) {
+      range->trip_len = aircraft.m_max_trip_len;
+    } else {
+      trip_ticks = full_range_ticks;
+      range->trip_len = (full_range_ticks - 1) * range->miles_per_tick;
+    }
+
+    range->trip_energy =
+        trip_ticks * range->energy_per_tick + RANGE_RESERVE_KWH;
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Only dispatch trips that the aircraft can finish on its remaining
+ * battery. Otherwise the aircraft goes to charge first.
+ * @param enable Whether to predict range at dispatch
+ */
+void Simulator::set_range_prediction(bool enable) {
+  m_range_prediction = enable;
+}
+
+/**
+ * @class Simulator
+ * @brief Change the charger allocation policy.
+ * @param policy The new policy
+ */
+void Simulator::set_charger_policy(ChargerPolicy policy) {
+  m_charger_policy = policy;
+}
+
+/**
+ * @class Simulator
+ * @brief Pause the tick at any charger allocation whose outcome depends on
+ * the charger policy, instead of allocating.
+ * @param defer Whether to defer contested allocations
+ */
+void Simulator::set_defer_contested(bool defer) { m_defer_contested = defer; }
+
+/**
+ * @class Simulator
+ * @brief Complete a charger allocation deferred by set_defer_contested(),
+ * using the current charger policy. Call step() afterwards to finish the
+ * paused tick.
+ */
+void Simulator::resolve_pending_allocation() {
+  if (!m_allocation_pending) {
+    return;
+  }
+
+  m_allocation_pending = false;
+  allocate_charger();
+}
+
+/**
+ * @class Simulator
+ * @brief Find the next aircraft to charge, and charge it, according to the
+ * charger policy.
+ *
+ * If contested allocations are being deferred and the policies don't all
+ * agree on which aircraft is next, nothing is allocated; the allocation is
+ * left pending instead.
+ *
+ * Under the Reservation policy the charger may go to an aircraft still in
+ * the air instead. It's held (counted as in use) until the aircraft next
+ * stops and takes it, rather than charging anyone in the meantime.
+ */
+void Simulator::allocate_charger() {
   if (m_num_chargers_in_use >= m_charger_count) {
     return;
   }
 
-  int longest_wait = -1;
-  int longest_wait_index = -1;
+  int next_index = find_charger_claim(m_charger_policy);
 
-  for (int i = 0; i < m_vehicle_count; i++) {
-    if (MODE__WAITING_TO_CHARGE == m_vehicles[i].m_sim_mode) {
-      if (m_vehicles[i].m_sim_ticks_waiting_chg > longest_wait) {
-        longest_wait = m_vehicles[i].m_sim_ticks_waiting_chg;
-        longest_wait_index = i;
+  if (m_defer_contested) {
+    for (int i = 0; i < MAX_CHARGER_POLICIES; i++) {
+      if (find_charger_claim((ChargerPolicy)i) != next_index) {
+        m_allocation_pending = true;
+        return;
       }
     }
   }
 
-  if (longest_wait_index > -1) {
+  if (next_index > -1 &&
+      MODE__WAITING_TO_CHARGE != m_vehicles[next_index].m_sim_mode) {
+    m_num_chargers_in_use++;
+    m_vehicles[next_index].m_sim_charger_held = true;
+  } else if (next_index > -1) {
     m_num_chargers_in_use++;
-    m_vehicles[longest_wait_index].m_sim_charging_sessions++;
-    m_vehicles[longest_wait_index].m_sim_ticks_waiting_chg = 0;
-    m_vehicles[longest_wait_index].m_sim_mode = MODE__CHARGING;
+    m_num_waiting--;
+    m_vehicles[next_index].m_sim_charging_sessions++;
+    m_vehicles[next_index].m_sim_ticks_waiting_chg = 0;
+    m_vehicles[next_index].m_sim_mode = MODE__CHARGING;
+
+    // It may already have been updated (and hashed) this tick
+    if (m_hash_trace) {
+      rehash(next_index);
+    }
   }
 }
 
+/**
+ * @class Simulator
+ * @brief Find the waiting aircraft that a policy would charge next.
+ * @param policy The charger policy to apply
+ * @return Index into m_vehicles, or -1 if no aircraft is waiting
+ *
+ * Ties go to the aircraft with the lowest index. Aircraft that already
+ * have a charger held for them don't need another.
+ */
+int Simulator::find_next_to_charge(ChargerPolicy policy) const {
+  int next_index = -1;
+
+  for (int i = 0; i < m_vehicle_count; i++) {
+    if (MODE__WAITING_TO_CHARGE == m_vehicles[i].m_sim_mode &&
+        !m_vehicles[i].m_sim_charger_held) {
+      if (next_index < 0 ||
+          has_charger_priority(policy, m_vehicles[i], m_vehicles[next_index])) {
+        next_index = i;
+      }
+    }
+  }
+
+  return next_index;
+}
+
+/**
+ * @class Simulator
+ * @brief Find the aircraft a policy would give a free charger to: one
+ * still in the air to hold it for (Reservation only), or the waiting
+ * aircraft it would charge next.
+ * @param policy The charger policy to apply
+ * @return Index into m_vehicles, or -1 if nobody gets the charger
+ */
+int Simulator::find_charger_claim(ChargerPolicy policy) const {
+  if (POLICY__RESERVATION == policy) {
+    int reserved_index = find_reservation();
+    if (reserved_index > -1) {
+      return reserved_index;
+    }
+  }
+
+  return find_next_to_charge(policy);
+}
+
+/**
+ * @class Simulator
+ * @brief Find the inbound aircraft a free charger would be held for under
+ * the Reservation policy.
+ * @return Index into m_vehicles, or -1 if no booking is due
+ *
+ * An aircraft books a charger when it's dispatched on a trip that won't
+ * leave enough battery for another. The booking is due once the trip's
+ * estimated end is within RESERVATION_LEAD_MS, and the earliest arrival
+ * goes first, ties to the lowest index.
+ */
+int Simulator::find_reservation() const {
+  int due_tick = m_ticks + RESERVATION_LEAD_MS / m_step_ms;
+  int next_index = -1;
+
+  for (int i = 0; i < m_vehicle_count; i++) {
+    const Aircraft &vehicle = m_vehicles[i];
+    if (MODE__FLYING == vehicle.m_sim_mode && vehicle.m_sim_charge_booked &&
+        !vehicle.m_sim_charger_held &&
+        vehicle.m_sim_est_arrival_tick <= due_tick &&
+        (next_index < 0 || vehicle.m_sim_est_arrival_tick <
+                               m_vehicles[next_index].m_sim_est_arrival_tick)) {
+      next_index = i;
+    }
+  }
+
+  return next_index;
+}
+
+/**
+ * @class Simulator
+ * @brief Check if aircraft `a` should charge before aircraft `b`.
+ * @param policy The charger policy to apply
+ */
+bool Simulator::has_charger_priority(ChargerPolicy policy, const Aircraft &a,
+                                     const Aircraft &b) const {
+  switch (policy) {
+  case POLICY__FIFO:
+    return a.m_sim_ticks_waiting_chg > b.m_sim_ticks_waiting_chg;
+  case POLICY__LOWEST_ENERGY:
+    return a.m_sim_rem_energy < b.m_sim_rem_energy;
+  case POLICY__SHORTEST_CHARGE:
+    return a.m_charge_time * (1 - a.m_sim_rem_energy / a.m_max_battery_cap) <
+           b.m_charge_time * (1 - b.m_sim_rem_energy / b.m_max_battery_cap);
+  case POLICY__EARLIEST_ARRIVAL:
+    return a.m_sim_est_arrival_tick < b.m_sim_est_arrival_tick;
+  case POLICY__RESERVATION: // Once the booked inbound aircraft are served
+    return a.m_sim_ticks_waiting_chg > b.m_sim_ticks_waiting_chg;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Calculate fleet-wide statistics.
+ */
+FleetStats Simulator::fleet_stats() const {
+  long long wait_ticks = 0;
+  long long chg_ticks = 0;
+  long long chg_sessions = 0;
+  FleetStats stats = {};
+
+  for (int i = 0; i < m_vehicle_count; i++) {
+    const Aircraft *vehicle = &m_vehicles[i];
+    wait_ticks += vehicle->m_mode_ticks[MODE__WAITING_TO_CHARGE];
+    chg_ticks += vehicle->m_mode_ticks[MODE__CHARGING];
+    chg_sessions += vehicle->m_sim_charging_sessions;
+    stats.passenger_miles += vehicle->m_sim_total_passenger_mi;
+    stats.faults += vehicle->m_sim_total_num_faults;
+    stats.trips_stranded += vehicle->m_sim_trips_stranded;
+    stats.trips_deferred += vehicle->m_sim_trips_deferred;
+  }
+
+  if (chg_sessions > 0) {
+    stats.wait_per_session =
+        (wait_ticks * (double)m_step_ms / MS_PER_HOUR) / chg_sessions;
+  }
+
+  int stats_ticks = m_ticks - m_stats_start_tick;
+  if (stats_ticks > 0 && m_charger_count > 0) {
+    stats.utilization = chg_ticks / ((double)stats_ticks * m_charger_count);
+  }
+
+  return stats;
+}
+
 /**
  * @class Simulator
  * @brief Output CSV report of how long each vehicle spent in each mode.
+ * @param out Stream to write the report to
  */
-void Simulator::report_time_per_mode() {
+void Simulator::report_time_per_mode(std::ostream &out) {
   // CSV header
-  std::cout << "VehicleNumber,VehicleType,Idle,Wait_Chg,Chg_Done,Chg,Fly"
-            << std::endl;
+  out << "VehicleNumber,VehicleType,Idle,Wait_Chg,Chg_Done,Chg,Fly"
+      << std::endl;
 
   Aircraft *vehicle;
+  int stats_ticks = m_ticks - m_stats_start_tick;
 
   for (int i = 0; i < m_vehicle_count; i++) {
     vehicle = &m_vehicles[i];
-    std::cout << i << "," << aircraft_type_str[vehicle->m_type] << ",";
+    out << i << "," << aircraft_type_str[vehicle->m_type] << ",";
 
     for (int j = 0; j < MAX_AIRCRAFT_MODES; j++) {
-      std::cout << (double)vehicle->m_mode_ticks[j] / m_ticks << ",";
+      out << (double)vehicle->m_mode_ticks[j] / stats_ticks << ",";
     }
 
-    std::cout << std::endl;
+    out << std::endl;
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Output CSV report of each vehicle's current state, including the
+ * fields state_hash() covers.
+ * @param out Stream to write the report to
+ */
+void Simulator::report_vehicle_state(std::ostream &out) {
+  // CSV header
+  out << "VehicleNumber,VehicleType,Mode,Trips,ChgSessions,Faults,Energy"
+      << std::endl;
+
+  for (int i = 0; i < m_vehicle_count; i++) {
+    const Aircraft *vehicle = &m_vehicles[i];
+    out << i << "," << aircraft_type_str[vehicle->m_type] << ","
+        << aircraft_mode_str[vehicle->m_sim_mode] << ","
+        << vehicle->m_sim_trips_started << ","
+        << vehicle->m_sim_charging_sessions << ","
+        << vehicle->m_sim_total_num_faults << ","
+        << vehicle->m_sim_rem_energy << std::endl;
   }
 }
 
@@ -204,73 +1240,116 @@ void Simulator::report_step(Aircraft *vehicle) {
  * @class Simulator
  * @brief Output CSV report of aggregate vehicle type statistics, per the
  * problem description.
+ * @param out Stream to write the report to
+ */
+void Simulator::report_vehicle_type_stats(std::ostream &out) {
+  TypeStats stats[MAX_AIRCRAFT_TYPES];
+  collect_type_stats(stats);
+  report_type_stats(stats, m_step_ms, out);
+}
+
+/**
+ * @class Simulator
+ * @brief Total up per-type statistics over the fleet.
+ * @param stats Array of MAX_AIRCRAFT_TYPES entries to fill in
+ */
+void Simulator::collect_type_stats(TypeStats *stats) const {
+  for (int i_type = 0; i_type < MAX_AIRCRAFT_TYPES; i_type++) {
+    stats[i_type] = TypeStats();
+  }
+
+  for (int j_vehicle = 0; j_vehicle < m_vehicle_count; j_vehicle++) {
+    const Aircraft *vehicle = &m_vehicles[j_vehicle];
+    TypeStats *type_stats = &stats[vehicle->m_type];
+
+    type_stats->vehicle_count++;
+    type_stats->passenger_miles += vehicle->m_sim_total_passenger_mi;
+    type_stats->faults += vehicle->m_sim_total_num_faults;
+    type_stats->flights += vehicle->m_sim_trips_started;
+    type_stats->flight_distance += vehicle->m_sim_total_miles;
+    type_stats->chg_sessions += vehicle->m_sim_charging_sessions;
+    type_stats->flight_ticks += vehicle->m_mode_ticks[MODE__FLYING];
+    type_stats->chg_ticks += vehicle->m_mode_ticks[MODE__CHARGING];
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Output CSV report of per-type time held on the ground by airspace
+ * limits.
+ * @param out Stream to write the report to
  */
-void Simulator::report_vehicle_type_stats() {
+void Simulator::report_environment_stats(std::ostream &out) {
   // CSV header
-  std::cout
-      << "VehicleType,VehicleCount,FlightTimePerFlight(Hours),DistPerFlight,"
-         "ChgSessionTime,"
-         "TotalFaults,TotalPassengerMiles"
-      << std::endl;
+  out << "VehicleType,TripsStarted,HoldTimePerVehicle(Hours)" << std::endl;
 
-  // Collect vehicle statistics to use in report calculations
   for (int i_type = 0; i_type < MAX_AIRCRAFT_TYPES; i_type++) {
-    std::cout << aircraft_type_str[i_type] << ",";
-
-    // Aggregate these statistics for each vehicle of this type
-    int vehicle_count = 0;
-    double total_flight_time = 0.0;
-    double total_flight_distance = 0.0;
-    int total_num_flights = 0;
-    double total_chg_time = 0.0;
-    int total_chg_sessions = 0;
-    int total_faults = 0;
-    int total_passenger_miles = 0;
+    long long vehicle_count = 0;
+    long long trips_started = 0;
+    long long held_ticks = 0;
 
     for (int j_vehicle = 0; j_vehicle < m_vehicle_count; j_vehicle++) {
       Aircraft *vehicle = &m_vehicles[j_vehicle];
 
       if (i_type == vehicle->m_type) {
         vehicle_count++;
-        total_passenger_miles += vehicle->m_sim_total_passenger_mi;
-        total_faults += vehicle->m_sim_total_num_faults;
-        total_num_flights += vehicle->m_sim_trips_started;
-        total_flight_distance += vehicle->m_sim_total_miles;
-        total_chg_sessions += vehicle->m_sim_charging_sessions;
-
-        total_flight_time += (vehicle->m_mode_ticks[MODE__FLYING] * m_step_ms) /
-                             (double)MS_PER_HOUR;
-
-        total_chg_time += (vehicle->m_mode_ticks[MODE__CHARGING] * m_step_ms) /
-                          (double)MS_PER_HOUR;
+        trips_started += vehicle->m_sim_trips_started;
+        held_ticks += vehicle->m_sim_ticks_held;
       }
     }
 
-    // Finally calculate the necessary statistics
-    double avg_flight_time;
-    double avg_flight_dist;
-    double avg_chg_time;
-
-    if (total_num_flights > 0) {
-      avg_flight_time = total_flight_time / (double)total_num_flights;
-    } else {
-      avg_flight_time = 0;
+    double hold_per_vehicle = 0;
+    if (vehicle_count > 0) {
+      hold_per_vehicle =
+          (held_ticks * (double)m_step_ms / MS_PER_HOUR) / vehicle_count;
     }
 
-    if (total_num_flights > 0) {
-      avg_flight_dist = total_flight_distance / (double)total_num_flights;
-    } else {
-      avg_flight_dist = 0;
+    out << aircraft_type_str[i_type] << "," << trips_started << ","
+        << hold_per_vehicle << std::endl;
+  }
+}
+
+/**
+ * @class Simulator
+ * @brief Output CSV report of per-type trip dispatch statistics.
+ * @param out Stream to write the report to
+ *
+ * Shows how often trips strand mid-flight versus get turned down at dispatch,
+ * and the knock-on effect on the charger queue.
+ */
+void Simulator::report_dispatch_stats(std::ostream &out) {
+  // CSV header
+  out << "VehicleType,TripsStarted,TripsStranded,TripsDeferred,"
+         "WaitPerChgSession(Hours)"
+      << std::endl;
+
+  for (int i_type = 0; i_type < MAX_AIRCRAFT_TYPES; i_type++) {
+    long long trips_started = 0;
+    long long trips_stranded = 0;
+    long long trips_deferred = 0;
+    long long wait_ticks = 0;
+    long long chg_sessions = 0;
+
+    for (int j_vehicle = 0; j_vehicle < m_vehicle_count; j_vehicle++) {
+      Aircraft *vehicle = &m_vehicles[j_vehicle];
+
+      if (i_type == vehicle->m_type) {
+        trips_started += vehicle->m_sim_trips_started;
+        trips_stranded += vehicle->m_sim_trips_stranded;
+        trips_deferred += vehicle->m_sim_trips_deferred;
+        wait_ticks += vehicle->m_mode_ticks[MODE__WAITING_TO_CHARGE];
+        chg_sessions += vehicle->m_sim_charging_sessions;
+      }
     }
 
-    if (total_chg_sessions > 0) {
-      avg_chg_time = total_chg_time / (double)total_chg_sessions;
-    } else {
-      avg_chg_time = 0;
+    double wait_per_session = 0;
+    if (chg_sessions > 0) {
+      wait_per_session =
+          (wait_ticks * (double)m_step_ms / MS_PER_HOUR) / chg_sessions;
     }
 
-    std::cout << vehicle_count << "," << avg_flight_time << ","
-              << avg_flight_dist << "," << avg_chg_time << "," << total_faults
-              << "," << total_passenger_miles << std::endl;
+    out << aircraft_type_str[i_type] << "," << trips_started << ","
+        << trips_stranded << "," << trips_deferred << "," << wait_per_session
+        << std::endl;
   }
 }
@@ -11,13 +11,127 @@
  *****************************************************************/
 
 #include "aircraft.hpp"
+#include "arena.hpp"
+#include "environment.hpp"
+#include "rng.hpp"
+#include <cstdint>
+#include <iostream>
+#include <vector>
 
 /*****************************************************************
  * Constants
  *****************************************************************/
 
-constexpr int MAX_VEHICLES = 20;
-constexpr int MAX_CHARGERS = 3;
+constexpr int DEFAULT_VEHICLES = 20;
+constexpr int DEFAULT_CHARGERS = 3;
+constexpr int DEFAULT_STEP_MS = 100;
+constexpr unsigned int DEFAULT_SEED = 12452;
+
+/** @brief Battery reserve kept back when predicting range (kWh). Covers the
+ * rounding error from draining the battery one tick at a time. */
+constexpr double RANGE_RESERVE_KWH = 1e-6;
+
+/** @brief How far ahead of its estimated arrival an aircraft's booked
+ * charger can be held for it under the Reservation policy (ms). */
+constexpr int RESERVATION_LEAD_MS = 15 * 60 * 1000;
+
+/** @brief Fleet image version this build reads and writes. */
+constexpr int FLEET_IMAGE_VERSION = 1;
+
+/** @brief Alignment of the fleet within a fleet image. A multiple of every
+ * common page size, so the fleet can be mapped straight from the file. */
+constexpr size_t FLEET_IMAGE_ALIGN = 64 * 1024;
+
+/*****************************************************************
+ * Enums and structs
+ *****************************************************************/
+
+/** @brief Enumerate the policies for choosing which aircraft charges next. */
+enum ChargerPolicy {
+  POLICY__FIFO,            /** Longest wait first */
+  POLICY__LOWEST_ENERGY,   /** Lowest remaining battery first */
+  POLICY__SHORTEST_CHARGE, /** Shortest time to full charge first */
+  POLICY__EARLIEST_ARRIVAL, /** Earliest estimated trip end first */
+  POLICY__RESERVATION,     /** Hold chargers for booked inbound aircraft,
+                              then longest wait first */
+  MAX_CHARGER_POLICIES,
+};
+
+/** @brief Everything needed to build a simulator. */
+struct SimulatorConfig {
+  int vehicle_count = DEFAULT_VEHICLES; /** Vehicles in the fleet */
+  int vehicle_capacity = 0; /** Room for vehicles added with add_vehicle(),
+                                0 for exactly vehicle_count */
+  int charger_count = DEFAULT_CHARGERS; /** Available chargers */
+  int step_ms = DEFAULT_STEP_MS;        /** Time step interval (ms) */
+  unsigned int seed = DEFAULT_SEED;     /** Seed for random numbers */
+  int type_weights[MAX_AIRCRAFT_TYPES] = {1, 1, 1, 1, 1}; /** Relative
+                                       share of each type in the fleet */
+  ChargerPolicy charger_policy = POLICY__FIFO; /** Charger allocation */
+  bool range_prediction = false; /** Check range before dispatching */
+  const Environment *environment = nullptr; /** Weather and airspace limits,
+                                               or nullptr for still air */
+};
+
+/** @brief Fleet-wide statistics used to compare charger policies. */
+struct FleetStats {
+  double wait_per_session; /** Avg time waiting per charge session (hours) */
+  double utilization;      /** Fraction of charger time spent charging */
+  double passenger_miles;  /** Total passenger miles flown */
+  long long faults;        /** Total faults */
+  long long trips_stranded; /** Trips that ran out of battery */
+  long long trips_deferred; /** Trips turned down to charge first */
+};
+
+/** @brief Per-type totals behind report_vehicle_type_stats(). Everything is
+ * a plain sum, so stats from separate fleets merge by adding them up. */
+struct TypeStats {
+  long long vehicle_count = 0;   /** Vehicles of this type */
+  long long flights = 0;         /** Trips started */
+  long long flight_ticks = 0;    /** Ticks spent flying */
+  long long chg_ticks = 0;       /** Ticks spent charging */
+  long long chg_sessions = 0;    /** Charging sessions */
+  long long faults = 0;          /** Faults */
+  long long passenger_miles = 0; /** Passenger miles (whole miles per
+                                     vehicle, as originally reported) */
+  double flight_distance = 0.0;  /** Miles flown */
+};
+
+/** @brief Precomputed per-type trip parameters for range prediction. */
+struct RangeTable {
+  double miles_per_tick;  /** Miles flown per tick at cruise */
+  double energy_per_tick; /** Energy used per tick at cruise (kWh) */
+  double trip_len;        /** Longest trip offered, that a full battery can
+                              fly in whole ticks (miles) */
+  double trip_energy;     /** Battery needed to fly trip_len (kWh) */
+};
+
+/*****************************************************************
+ * Globals
+ *****************************************************************/
+
+/** @brief Stringified ChargerPolicy enum. */
+extern const char *charger_policy_str[];
+
+/*****************************************************************
+ * Function declarations
+ *****************************************************************/
+
+/**
+ * @brief Add one set of per-type statistics into another.
+ * @param into Array of MAX_AIRCRAFT_TYPES entries to add to
+ * @param from Array of MAX_AIRCRAFT_TYPES entries to add
+ */
+void merge_type_stats(TypeStats *into, const TypeStats *from);
+
+/**
+ * @brief Output CSV report of aggregate vehicle type statistics, per the
+ * problem description.
+ * @param stats Array of MAX_AIRCRAFT_TYPES entries
+ * @param step_ms Time step the stats were collected with (ms)
+ * @param out Stream to write the report to
+ */
+void report_type_stats(const TypeStats *stats, int step_ms, std::ostream &out);
 
 /*****************************************************************
  * Class definition
@@ -26,18 +140,67 @@ constexpr int MAX_CHARGERS = 3;
 /**
  * @class Simulator
  * @brief Simulates a fleet of aircraft.
+ *
+ * All per-run memory comes from an Arena. By default the simulator owns one
+ * sized for its fleet, but when building and tearing down lots of simulators
+ * it's much cheaper to pass in a shared arena and reset() it between runs.
+ * The arena must outlive the simulator.
  */
 class Simulator {
 public:
-  Simulator(int vehicle_count);
+  Simulator(const SimulatorConfig &config, Arena *arena = nullptr);
+  Simulator(int vehicle_count, unsigned int seed,
+            ChargerPolicy policy = POLICY__FIFO, Arena *arena = nullptr);
+  Simulator(const Simulator &other, Arena *arena = nullptr);
   ~Simulator() = default;
 
+  Simulator &operator=(const Simulator &) = delete;
+
+  /**
+   * @class Simulator
+   * @brief Arena space needed for a simulator's per-run memory.
+   * @param vehicle_count Number of vehicles the simulator has room for.
+   */
+  static size_t arena_bytes(int vehicle_count);
+
   /**
    * @class Simulator
    * @brief Run a complete simulation.
    * @param duration_ms Sim time, in milliseconds
    */
-  void simulate(int simtime_ms);
+  void simulate(long long duration_ms);
+
+  /**
+   * @class Simulator
+   * @brief Run (or finish running) a single tick of the simulation.
+   * @return false if the tick was paused at a deferred charger allocation,
+   * true once the tick is complete.
+   */
+  bool step();
+
+  /**
+   * @class Simulator
+   * @brief Add an aircraft to the end of the fleet, between ticks.
+   * @param vehicle The aircraft to add
+   * @return false if the fleet is at capacity and there's no memory to grow
+   * it
+   *
+   * A full fleet is moved to a new array twice the size, so pointers into
+   * vehicles() don't survive adding an aircraft.
+   */
+  bool add_vehicle(const Aircraft &vehicle);
+
+  /**
+   * @class Simulator
+   * @brief Remove the waiting aircraft that the charger policy would charge
+   * next from the fleet, between ticks.
+   * @param vehicle Where to put the removed aircraft
+   * @return false if no aircraft is waiting
+   *
+   * The aircraft after it each move down one place, so the rest of the
+   * fleet keeps its order.
+   */
+  bool take_next_to_charge(Aircraft *vehicle);
 
   /**
    * @class Simulator
@@ -46,18 +209,185 @@ public:
    */
   void update_aircraft(Aircraft *vehicle);
 
+  /**
+   * @class Simulator
+   * @brief Change the charger allocation policy.
+   * @param policy The new policy
+   */
+  void set_charger_policy(ChargerPolicy policy);
+
+  /**
+   * @class Simulator
+   * @brief Only dispatch trips that the aircraft can finish on its remaining
+   * battery. Otherwise the aircraft goes to charge first.
+   * @param enable Whether to predict range at dispatch
+   */
+  void set_range_prediction(bool enable);
+
+  /**
+   * @class Simulator
+   * @brief Pause the tick at any charger allocation whose outcome depends on
+   * the charger policy, instead of allocating.
+   * @param defer Whether to defer contested allocations
+   */
+  void set_defer_contested(bool defer);
+
+  /**
+   * @class Simulator
+   * @brief Complete a charger allocation deferred by set_defer_contested(),
+   * using the current charger policy. Call step() afterwards to finish the
+   * paused tick.
+   */
+  void resolve_pending_allocation();
+
+  /**
+   * @class Simulator
+   * @brief Save the complete simulator state (fleet, charger queue, random
+   * state, options) to a fleet image file, between ticks.
+   * @param path Path to the image file
+   * @return true on success. On failure, the problem is printed to stderr.
+   */
+  bool save_image(const char *path) const;
+
+  /**
+   * @class Simulator
+   * @brief Replace this simulator's state with a saved fleet image.
+   * @param path Path to the image file
+   * @param environment The environment the image was saved with, if any
+   * @return true on success. On failure, the problem is printed to stderr
+   * and the simulator is unchanged.
+   */
+  bool load_image(const char *path, const Environment *environment = nullptr);
+
+  /**
+   * @class Simulator
+   * @brief Zero the fleet's counters so reports only cover ticks from now on,
+   * e.g. to leave a warm-up loaded with load_image() out of them.
+   */
+  void reset_stats();
+
+  /**
+   * @class Simulator
+   * @brief Record state_hash() at the end of every tick from now on.
+   * @param trace Vector to append a hash per tick to, or nullptr to stop.
+   * Copies of the simulator don't record.
+   * @param energy Also hash each aircraft's battery energy (see
+   * vehicle_energy_hash()). Only comparable with other state machine runs.
+   *
+   * Each aircraft's hash is worked out once here, and after that only when
+   * its mode or counts change, so recording doesn't rehash the fleet every
+   * tick.
+   */
+  void set_hash_trace(std::vector<uint64_t> *trace, bool energy = false);
+
+  /**
+   * @class Simulator
+   * @brief Hash of the fleet's discrete state: the sum of
+   * vehicle_state_hash() over the fleet, plus vehicle_energy_hash() if the
+   * hash trace includes energy.
+   */
+  uint64_t state_hash() const;
+
+  /**
+   * @class Simulator
+   * @brief Elapsed simulation ticks.
+   */
+  int ticks() const { return m_ticks; }
+
+  /**
+   * @class Simulator
+   * @brief Tick the reports start from: 0, or when reset_stats() was last
+   * called. Reports cover ticks() - stats_start_tick() ticks.
+   */
+  int stats_start_tick() const { return m_stats_start_tick; }
+
+  /**
+   * @class Simulator
+   * @brief Simulation time step interval (ms).
+   */
+  int step_ms() const { return m_step_ms; }
+
+  /**
+   * @class Simulator
+   * @brief Number of aircraft in the fleet.
+   */
+  int vehicle_count() const { return m_vehicle_count; }
+
+  /**
+   * @class Simulator
+   * @brief The fleet, vehicle_count() aircraft long. The array is updated
+   * in place every tick, and only moves if add_vehicle() has to grow it.
+   */
+  const Aircraft *vehicles() const { return m_vehicles; }
+
+  /**
+   * @class Simulator
+   * @brief Number of chargers not in use.
+   */
+  int free_chargers() const { return m_charger_count - m_num_chargers_in_use; }
+
+  /**
+   * @class Simulator
+   * @brief Number of aircraft waiting for a charger.
+   */
+  int waiting_count() const { return m_num_waiting; }
+
+  /**
+   * @class Simulator
+   * @brief Check if the current tick is paused at a deferred allocation.
+   */
+  bool allocation_pending() const { return m_allocation_pending; }
+
+  /**
+   * @class Simulator
+   * @brief Calculate fleet-wide statistics.
+   */
+  FleetStats fleet_stats() const;
+
   /**
    * @class Simulator
    * @brief Output CSV report of how long each vehicle spent in each mode.
+   * @param out Stream to write the report to
    */
-  void report_time_per_mode();
+  void report_time_per_mode(std::ostream &out = std::cout);
 
   /**
    * @class Simulator
    * @brief Output CSV report of aggregate vehicle type statistics, per the
    * problem description.
+   * @param out Stream to write the report to
+   */
+  void report_vehicle_type_stats(std::ostream &out = std::cout);
+
+  /**
+   * @class Simulator
+   * @brief Total up per-type statistics over the fleet.
+   * @param stats Array of MAX_AIRCRAFT_TYPES entries to fill in
+   */
+  void collect_type_stats(TypeStats *stats) const;
+
+  /**
+   * @class Simulator
+   * @brief Output CSV report of per-type time held on the ground by airspace
+   * limits.
+   * @param out Stream to write the report to
+   */
+  void report_environment_stats(std::ostream &out = std::cout);
+
+  /**
+   * @class Simulator
+   * @brief Output CSV report of per-type trip dispatch statistics.
+   * @param out Stream to write the report to
+   */
+  void report_dispatch_stats(std::ostream &out = std::cout);
+
+  /**
+   * @class Simulator
+   * @brief Output CSV report of each vehicle's current state, including the
+   * fields state_hash() covers.
+   * @param out Stream to write the report to
    */
-  void report_vehicle_type_stats();
+  void report_vehicle_state(std::ostream &out = std::cout);
 
   /**
    * @class Simulator
@@ -67,29 +397,129 @@ public:
   void report_step(Aircraft *vehicle);
 
 private:
-  int m_vehicle_count = MAX_VEHICLES; /** Vehicles to use in simulation */
-  int m_charger_count = MAX_CHARGERS; /** Available chargers */
-  int m_num_chargers_in_use = 0;      /** Chargers actively being used */
-  int m_ticks = 0;                    /** Total elapsed simulation ticks */
-  int m_step_ms = 100;                /** Time step interval (ms) */
-
-  /** Data for simulated vehicles.
-   * @note This is slicing, but the simulation still works as intended
-   * because the derived classes do not have any data/custom behavior of their
-   * own, and just update base class variables. This would need to be fixed if
-   * this were not the case.
-   *
-   * I don't particularly want to refactor everything right now.
-   * But the correct thing to do would be:
-   * std::unique_ptr<Aircraft> m_vehicles[MAX_VEHICLES];
+  friend class BehaviorEngine; // Drives the fleet with its own tick loop
+
+  int m_vehicle_count = DEFAULT_VEHICLES; /** Vehicles to use in simulation */
+  int m_vehicle_capacity = DEFAULT_VEHICLES; /** Room in m_vehicles */
+  int m_charger_count = DEFAULT_CHARGERS; /** Available chargers */
+  int m_num_chargers_in_use = 0;          /** Chargers actively being used */
+  int m_num_waiting = 0;                  /** Aircraft waiting for a charger */
+  int m_ticks = 0;                        /** Total elapsed simulation ticks */
+  int m_stats_start_tick = 0;             /** Tick the stats start from */
+  int m_step_ms = DEFAULT_STEP_MS;        /** Time step interval (ms) */
+  int m_next_vehicle = 0;             /** Next vehicle to update this tick */
+  ChargerPolicy m_charger_policy = POLICY__FIFO; /** Charger allocation */
+  bool m_defer_contested = false;    /** Pause at contested allocations */
+  bool m_allocation_pending = false; /** Paused at a contested allocation */
+  bool m_range_prediction = false;   /** Check range before dispatching */
+  RangeTable m_range_table[MAX_AIRCRAFT_TYPES]; /** Per-type trip params */
+  const Environment *m_environment = nullptr; /** Weather and airspace */
+  const EnvCell *m_env_row = nullptr; /** Conditions per region this tick */
+  int m_region_flying[ENV_MAX_REGIONS] = {}; /** Aircraft flying per region */
+  Rng m_rng;                         /** Random numbers for this simulation */
+  std::vector<uint64_t> *m_hash_trace = nullptr; /** Hash per tick, if
+                                                    recording */
+  uint64_t *m_vehicle_hashes = nullptr; /** State hash per aircraft, from
+                                           m_arena once recording */
+  uint64_t m_state_hash = 0;              /** Sum of m_vehicle_hashes */
+  bool m_hash_energy = false;             /** Hashes include energy */
+  Arena m_own_arena; /** Per-run memory, if no arena was passed in */
+  Arena *m_arena;    /** Where per-run memory is allocated from */
+
+  /** Data for simulated vehicles, allocated from m_arena.
+   * @note The derived classes do not have any data/custom behavior of their
+   * own, and just set base class variables, so vehicles are stored by value
+   * as plain Aircraft. This would need to be fixed if this were not the case.
    **/
-  Aircraft m_vehicles[MAX_VEHICLES];
+  Aircraft *m_vehicles;
+
+  /**
+   * @class Simulator
+   * @brief vehicle_state_hash() (and vehicle_energy_hash(), if hashing
+   * energy) for one aircraft in the fleet.
+   * @param index Index of vehicle in m_vehicles
+   */
+  uint64_t vehicle_hash(int index) const;
+
+  /**
+   * @class Simulator
+   * @brief Update the state hash after an aircraft's mode or counts change.
+   * @param index Index of vehicle in m_vehicles
+   */
+  void rehash(int index);
+
+  /**
+   * @class Simulator
+   * @brief Move the fleet to a bigger array.
+   * @param capacity Number of aircraft the new array has room for
+   * @return false if there's no memory for it
+   */
+  bool grow_fleet(int capacity);
+
+  /**
+   * @class Simulator
+   * @brief Find the next aircraft to charge, and charge it, according to the
+   * charger policy.
+   */
+  void allocate_charger();
+
+  /**
+   * @class Simulator
+   * @brief Find the waiting aircraft that a policy would charge next.
+   * @param policy The charger policy to apply
+   * @return Index into m_vehicles, or -1 if no aircraft is waiting
+   */
+  int find_next_to_charge(ChargerPolicy policy) const;
+
+  /**
+   * @class Simulator
+   * @brief Find the aircraft a policy would give a free charger to: one
+   * still in the air to hold it for (Reservation only), or the waiting
+   * aircraft it would charge next.
+   * @param policy The charger policy to apply
+   * @return Index into m_vehicles, or -1 if nobody gets the charger
+   */
+  int find_charger_claim(ChargerPolicy policy) const;
+
+  /**
+   * @class Simulator
+   * @brief Find the inbound aircraft a free charger would be held for under
+   * the Reservation policy.
+   * @return Index into m_vehicles, or -1 if no booking is due
+   */
+  int find_reservation() const;
+
+  /**
+   * @class Simulator
+   * @brief Check if aircraft `a` should charge before aircraft `b`.
+   * @param policy The charger policy to apply
+   */
+  bool has_charger_priority(ChargerPolicy policy, const Aircraft &a,
+                            const Aircraft &b) const;
+
+  /**
+   * @class Simulator
+   * @brief Fill in m_range_table for the current time step.
+   */
+  void build_range_table();
+
+  /**
+   * @class Simulator
+   * @brief Ground speed and energy use for an aircraft in this tick's
+   * conditions.
+   * @param vehicle The aircraft
+   * @param speed Set to the ground speed (mph)
+   * @param energy_per_mile Set to the energy used per ground mile (kWh/mile)
+   */
+  void flight_conditions(const Aircraft *vehicle, double *speed,
+                         double *energy_per_mile) const;
 
   /**
    * @class Simulator
-   * @brief Find the next aircraft to charge, and charge it. FIFO waiting queue.
+   * @brief Send an idle aircraft on a trip, or to charge if it can't make it.
+   * @param vehicle The aircraft to dispatch
    */
-  void allocate_charger_fifo();
+  void dispatch_trip(Aircraft *vehicle);
 };
 
 #endif /* SIMULATOR_H */
@@ -0,0 +1,38 @@
+/**
+ * @file state_hash.cpp
+ * @brief Hash trace output.
+ */
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include "state_hash.hpp"
+#include <iomanip>
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Write a hash trace: one fleet state hash per tick.
+ * @param trace Hash per tick, in tick order
+ * @param step_ms Simulation time step interval (ms)
+ * @param start_tick Tick the first hash is for
+ * @param energy Whether the hashes include vehicle_energy_hash()
+ * @param out Stream to write the trace to
+ */
+void write_hash_trace(const std::vector<uint64_t> &trace, int step_ms,
+                      int start_tick, bool energy, std::ostream &out) {
+  out << "version " << HASH_TRACE_VERSION << "\n"
+      << "step_ms " << step_ms << "\n"
+      << "start_tick " << start_tick << "\n"
+      << "energy " << (energy ? 1 : 0) << "\n"
+      << "ticks " << trace.size() << "\n";
+
+  out << std::hex << std::setfill('0');
+  for (uint64_t hash : trace) {
+    out << std::setw(16) << hash << "\n";
+  }
+  out << std::dec << std::setfill(' ');
+}
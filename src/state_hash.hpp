@@ -0,0 +1,107 @@
+/**
+ * @file state_hash.hpp
+ * @brief Per-tick fleet state hashes, for finding where two runs diverge.
+ */
+
+#ifndef STATE_HASH_H
+#define STATE_HASH_H
+
+/*****************************************************************
+ * Includes
+ *****************************************************************/
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/*****************************************************************
+ * Constants
+ *****************************************************************/
+
+/** @brief Newest hash trace file version this build writes. */
+constexpr int HASH_TRACE_VERSION = 3;
+
+/** @brief Resolution battery energy is hashed at (steps per kWh). */
+constexpr double HASH_ENERGY_PER_KWH = 1000.0;
+
+/*****************************************************************
+ * Function definitions
+ *****************************************************************/
+
+/**
+ * @brief Scramble 64 bits (the splitmix64 finalizer).
+ */
+inline uint64_t hash_mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/**
+ * @brief Hash one aircraft's discrete state at the end of a tick.
+ * @param index Index of the aircraft in the fleet
+ * @param mode Current mode
+ * @param trips Trips started
+ * @param sessions Charging sessions
+ * @param faults Faults
+ *
+ * Continuous state (energy, miles) is left out, since the behavior engine
+ * only works it out per phase. A real difference in it changes a mode or a
+ * count soon enough. Between two state machine runs, add
+ * vehicle_energy_hash() to catch it on the tick it happens.
+ */
+inline uint64_t vehicle_state_hash(int index, int mode, int trips,
+                                   int sessions, int faults) {
+  // One mix per aircraft keeps a full-fleet hash cheap enough to take every
+  // tick. Counts wrap within their fields, which only matters past ~1M.
+  uint64_t state = (uint64_t)(mode & 0x7) |
+                   ((uint64_t)(faults & 0x1fffff) << 3) |
+                   ((uint64_t)(sessions & 0xfffff) << 24) |
+                   ((uint64_t)(trips & 0xfffff) << 44);
+  return hash_mix((uint64_t)index * 0x9e3779b97f4a7c15ULL + state);
+}
+
+/**
+ * @brief Hash one aircraft's battery energy at the end of a tick, to the
+ * nearest watt-hour.
+ * @param index Index of the aircraft in the fleet
+ * @param energy Remaining battery (kWh)
+ */
+inline uint64_t vehicle_energy_hash(int index, double energy) {
+  uint64_t steps = (uint64_t)std::llround(energy * HASH_ENERGY_PER_KWH);
+  return hash_mix((uint64_t)index * 0xc2b2ae3d27d4eb4fULL + steps);
+}
+
+/*****************************************************************
+ * Function declarations
+ *****************************************************************/
+
+/**
+ * @brief Write a hash trace: one fleet state hash per tick.
+ * @param trace Hash per tick, in tick order
+ * @param step_ms Simulation time step interval (ms)
+ * @param start_tick Tick the first hash is for: 0, or the ticks already run
+ * by a fleet image the run resumed from
+ * @param energy Whether the hashes include vehicle_energy_hash()
+ * @param out Stream to write the trace to
+ *
+ * The fleet hash is the sum of vehicle_state_hash() (plus, with `energy`,
+ * vehicle_energy_hash()) over the fleet, so it can be kept up to date one
+ * aircraft at a time. Format:
+ *
+ *   version 3
+ *   step_ms 100
+ *   start_tick 0
+ *   energy 0
+ *   ticks 108000
+ *   <hash for tick start_tick, 16 hex digits>
+ *   ...
+ */
+void write_hash_trace(const std::vector<uint64_t> &trace, int step_ms,
+                      int start_tick, bool energy, std::ostream &out);
+
+#endif /* STATE_HASH_H */
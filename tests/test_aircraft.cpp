@@ -80,6 +80,34 @@ TEST(AircraftTest, FlyTimestep) {
   EXPECT_NEAR(charlie.m_sim_rem_energy, initial_energy - 29.33, 0.5);
 }
 
+/**
+ * @brief Verify the gaps drawn between faults give the hourly fault rate.
+ *
+ * - A fault can be due on the first tick asked for, never before
+ * - Over many draws, faults per hour match m_p_fault_hourly
+ * - An aircraft that can't fault never gets a fault tick
+ */
+TEST(AircraftTest, FaultGapsMatchHourlyRate) {
+  Alpha alpha;
+  Rng rng(7);
+  int step_ms = 1000;
+  int draws = 20000;
+
+  long long ticks = 0;
+  for (int i = 0; i < draws; i++) {
+    int tick = alpha.next_fault_tick(100, step_ms, rng);
+    ASSERT_GE(tick, 100);
+    ticks += tick - 100 + 1;
+  }
+
+  double hours = (double)ticks * step_ms / MS_PER_HOUR;
+  EXPECT_NEAR(draws / hours, alpha.m_p_fault_hourly,
+              alpha.m_p_fault_hourly * 0.03);
+
+  alpha.m_p_fault_hourly = 0;
+  EXPECT_EQ(alpha.next_fault_tick(0, step_ms, rng), INT_MAX);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,191 @@
+#include "../src/behavior.hpp"
+#include "../src/common.hpp"
+#include <gtest/gtest.h>
+
+/**
+ * @brief Check two fleets ended up in exactly the same state.
+ */
+static void expect_same_fleet(const Simulator &actual,
+                              const Simulator &expected) {
+  ASSERT_EQ(actual.ticks(), expected.ticks());
+  ASSERT_EQ(actual.vehicle_count(), expected.vehicle_count());
+  EXPECT_EQ(actual.free_chargers(), expected.free_chargers());
+  EXPECT_EQ(actual.waiting_count(), expected.waiting_count());
+
+  for (int i = 0; i < expected.vehicle_count(); i++) {
+    const Aircraft &a = actual.vehicles()[i];
+    const Aircraft &e = expected.vehicles()[i];
+
+    EXPECT_EQ(a.m_sim_mode, e.m_sim_mode) << "vehicle " << i;
+    EXPECT_EQ(a.m_sim_rem_energy, e.m_sim_rem_energy) << "vehicle " << i;
+    EXPECT_EQ(a.m_sim_total_miles, e.m_sim_total_miles) << "vehicle " << i;
+    EXPECT_EQ(a.m_sim_total_passenger_mi, e.m_sim_total_passenger_mi);
+    EXPECT_EQ(a.m_sim_total_num_faults, e.m_sim_total_num_faults);
+    EXPECT_EQ(a.m_sim_next_fault_tick, e.m_sim_next_fault_tick);
+    EXPECT_EQ(a.m_sim_trips_started, e.m_sim_trips_started);
+    EXPECT_EQ(a.m_sim_charging_sessions, e.m_sim_charging_sessions);
+    EXPECT_EQ(a.m_sim_trips_stranded, e.m_sim_trips_stranded);
+    EXPECT_EQ(a.m_sim_trips_deferred, e.m_sim_trips_deferred);
+    EXPECT_EQ(a.m_sim_ticks_waiting_chg, e.m_sim_ticks_waiting_chg);
+
+    for (int mode = 0; mode < MAX_AIRCRAFT_MODES; mode++) {
+      EXPECT_EQ(a.m_mode_ticks[mode], e.m_mode_ticks[mode])
+          << "vehicle " << i << " mode " << mode;
+    }
+  }
+}
+
+/**
+ * @brief Verify the engine running the default behavior leaves the fleet
+ * exactly as the state machine does, for every charger policy it supports,
+ * with and without range prediction, including phases cut off by the end of
+ * the run.
+ */
+TEST(BehaviorTest, MatchesStateMachine) {
+  for (int policy = 0; policy < MAX_CHARGER_POLICIES; policy++) {
+    for (int predict = 0; predict < 2; predict++) {
+      SimulatorConfig config;
+      config.vehicle_count = 60;
+      config.charger_count = 4;
+      config.step_ms = 700;
+      config.charger_policy = (ChargerPolicy)policy;
+      config.range_prediction = predict;
+      long long duration_ms = MS_PER_HOUR * 5 + 12345;
+      if (!BehaviorEngine::supports(config)) {
+        continue;
+      }
+
+      BehaviorEngine engine(config);
+      engine.simulate(duration_ms);
+
+      Simulator expected(config);
+      expected.simulate(duration_ms);
+
+      SCOPED_TRACE("policy " + std::to_string(policy) + " predict " +
+                   std::to_string(predict));
+      expect_same_fleet(engine.simulator(), expected);
+      EXPECT_LT(engine.wakeups(),
+                (long long)config.vehicle_count * expected.ticks() / 10);
+    }
+  }
+}
+
+/**
+ * @brief A script that rests on the ground for ten minutes after each trip.
+ */
+static Behavior resting_behavior(BehaviorEngine &engine, int index) {
+  int rest_ticks = MS_PER_HOUR / 6 / engine.simulator().step_ms();
+
+  while (true) {
+    if (engine.dispatch_trip(index) && co_await engine.fly(index)) {
+      co_await engine.hold(index, rest_ticks);
+      continue;
+    }
+
+    co_await engine.charge(index);
+    co_await engine.next_tick(index);
+  }
+}
+
+/**
+ * @brief Total ticks a type spent in each mode.
+ */
+static void type_mode_ticks(const Simulator &sim, AircraftType type,
+                            long long mode_ticks[MAX_AIRCRAFT_MODES]) {
+  for (int mode = 0; mode < MAX_AIRCRAFT_MODES; mode++) {
+    mode_ticks[mode] = 0;
+  }
+
+  for (int i = 0; i < sim.vehicle_count(); i++) {
+    const Aircraft &vehicle = sim.vehicles()[i];
+    if (type == vehicle.m_type) {
+      for (int mode = 0; mode < MAX_AIRCRAFT_MODES; mode++) {
+        mode_ticks[mode] += vehicle.m_mode_ticks[mode];
+      }
+    }
+  }
+}
+
+/**
+ * @brief Verify a custom script drives the type it is set for, and that the
+ * time it holds counts as idle.
+ */
+TEST(BehaviorTest, CustomScriptRestsBetweenTrips) {
+  SimulatorConfig config;
+  config.range_prediction = true; // Otherwise every trip runs the battery out
+  long long duration_ms = MS_PER_HOUR * 3;
+
+  BehaviorEngine plain(config);
+  plain.simulate(duration_ms);
+
+  BehaviorEngine resting(config);
+  resting.set_behavior(TYPE__ECHO, resting_behavior);
+  resting.simulate(duration_ms);
+  EXPECT_GE(resting.frame_pool().chunks(), 1u);
+
+  long long plain_ticks[MAX_AIRCRAFT_MODES];
+  long long resting_ticks[MAX_AIRCRAFT_MODES];
+  type_mode_ticks(plain.simulator(), TYPE__ECHO, plain_ticks);
+  type_mode_ticks(resting.simulator(), TYPE__ECHO, resting_ticks);
+  EXPECT_GT(resting_ticks[MODE__IDLE], plain_ticks[MODE__IDLE]);
+
+  long long total_ticks = 0;
+  for (int mode = 0; mode < MAX_AIRCRAFT_MODES; mode++) {
+    total_ticks += resting_ticks[mode];
+  }
+
+  TypeStats stats[MAX_AIRCRAFT_TYPES];
+  resting.simulator().collect_type_stats(stats);
+  EXPECT_EQ(total_ticks, (long long)stats[TYPE__ECHO].vehicle_count *
+                             resting.simulator().ticks());
+}
+
+/**
+ * @brief Verify a second simulate() call leaves the finished run alone.
+ */
+TEST(BehaviorTest, SimulatesOnce) {
+  SimulatorConfig config;
+  BehaviorEngine engine(config);
+  engine.simulate(MS_PER_HOUR);
+  long long wakeups = engine.wakeups();
+
+  engine.simulate(MS_PER_HOUR);
+  EXPECT_EQ(engine.simulator().ticks(), MS_PER_HOUR / config.step_ms);
+  EXPECT_EQ(engine.wakeups(), wakeups);
+}
+
+/**
+ * @brief Verify the engine's hash trace matches the state machine's tick for
+ * tick, even though the engine only touches aircraft at phase boundaries.
+ */
+TEST(BehaviorTest, HashTraceMatchesStateMachine) {
+  for (int policy = 0; policy < MAX_CHARGER_POLICIES; policy++) {
+    SimulatorConfig config;
+    config.vehicle_count = 60;
+    config.charger_count = 4;
+    config.charger_policy = (ChargerPolicy)policy;
+    long long duration_ms = MS_PER_HOUR * 3;
+    if (!BehaviorEngine::supports(config)) {
+      continue;
+    }
+
+    std::vector<uint64_t> engine_trace;
+    BehaviorEngine engine(config);
+    engine.set_hash_trace(&engine_trace);
+    engine.simulate(duration_ms);
+
+    std::vector<uint64_t> expected_trace;
+    Simulator expected(config);
+    expected.set_hash_trace(&expected_trace);
+    expected.simulate(duration_ms);
+
+    ASSERT_EQ(engine_trace.size(), expected_trace.size());
+    size_t tick = 0;
+    while (tick < expected_trace.size() &&
+           engine_trace[tick] == expected_trace[tick]) {
+      tick++;
+    }
+    EXPECT_EQ(tick, expected_trace.size()) << "policy " << policy;
+    expect_same_fleet(engine.simulator(), expected);
+  }
+}
@@ -0,0 +1,106 @@
+#include "../src/common.hpp"
+#include "../src/evtol_sim.h"
+#include "../src/simulator.hpp"
+#include <gtest/gtest.h>
+
+/**
+ * @brief Verify a run through the C API gives the same results as the
+ * simulator, and that the views read them straight out of the fleet.
+ */
+TEST(EvtolSimTest, MatchesSimulator) {
+  ASSERT_EQ(evtol_sim_abi_version(), EVTOL_SIM_ABI_VERSION);
+
+  evtol_sim_config config;
+  evtol_sim_config_init(&config);
+
+  evtol_sim *sim = evtol_sim_create(&config);
+  ASSERT_NE(sim, nullptr);
+  evtol_sim_run(sim, MS_PER_HOUR * 3);
+
+  Simulator expected(SimulatorConfig{});
+  expected.simulate(MS_PER_HOUR * 3);
+
+  ASSERT_EQ(evtol_sim_ticks(sim), expected.ticks());
+  ASSERT_EQ(evtol_sim_vehicle_count(sim), expected.vehicle_count());
+
+  evtol_view faults;
+  evtol_view miles;
+  ASSERT_EQ(evtol_sim_vehicle_view(sim, EVTOL_FIELD_FAULTS, &faults), 0);
+  ASSERT_EQ(evtol_sim_vehicle_view(sim, EVTOL_FIELD_MILES, &miles), 0);
+  ASSERT_EQ(faults.count, (size_t)expected.vehicle_count());
+
+  for (size_t i = 0; i < faults.count; i++) {
+    const Aircraft &vehicle = expected.vehicles()[i];
+    const char *fault_data = (const char *)faults.data + i * faults.stride;
+    const char *mile_data = (const char *)miles.data + i * miles.stride;
+
+    EXPECT_EQ(*(const int32_t *)fault_data, vehicle.m_sim_total_num_faults);
+    EXPECT_EQ(*(const double *)mile_data, vehicle.m_sim_total_miles);
+  }
+
+  TypeStats expected_stats[MAX_AIRCRAFT_TYPES];
+  expected.collect_type_stats(expected_stats);
+  const evtol_type_stats *stats = evtol_sim_type_stats(sim);
+
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    EXPECT_EQ(stats[i].vehicle_count, expected_stats[i].vehicle_count);
+    EXPECT_EQ(stats[i].flights, expected_stats[i].flights);
+    EXPECT_EQ(stats[i].faults, expected_stats[i].faults);
+    EXPECT_EQ(stats[i].flight_distance, expected_stats[i].flight_distance);
+  }
+
+  evtol_sim_destroy(sim);
+}
+
+/**
+ * @brief Verify bad configurations are turned away rather than crashing.
+ */
+TEST(EvtolSimTest, RejectsBadConfig) {
+  evtol_sim_config config;
+  evtol_sim_config_init(&config);
+  config.charger_policy = 99;
+  EXPECT_EQ(evtol_sim_create(&config), nullptr);
+
+  evtol_sim_config_init(&config);
+  config.step_ms = 0;
+  EXPECT_EQ(evtol_sim_create(&config), nullptr);
+
+  evtol_sim_config_init(&config);
+  for (int i = 0; i < EVTOL_SIM_AIRCRAFT_TYPES; i++) {
+    config.type_weights[i] = 0;
+  }
+  EXPECT_EQ(evtol_sim_create(&config), nullptr);
+}
+
+/**
+ * @brief Verify an empty fleet runs and gives empty views, not pointers
+ * formed from a missing array.
+ */
+TEST(EvtolSimTest, EmptyFleet) {
+  evtol_sim_config config;
+  evtol_sim_config_init(&config);
+  config.vehicle_count = 0;
+
+  evtol_sim *sim = evtol_sim_create(&config);
+  ASSERT_NE(sim, nullptr);
+  evtol_sim_run(sim, MS_PER_HOUR);
+  EXPECT_EQ(evtol_sim_vehicle_count(sim), 0);
+
+  for (int field = 0; field <= EVTOL_FIELD_MODE_TICKS; field++) {
+    evtol_view view;
+    ASSERT_EQ(
+        evtol_sim_vehicle_view(sim, (evtol_vehicle_field)field, &view), 0);
+    EXPECT_EQ(view.data, nullptr);
+    EXPECT_EQ(view.count, 0u);
+  }
+
+  evtol_view view;
+  EXPECT_EQ(evtol_sim_vehicle_view(sim, (evtol_vehicle_field)99, &view), -1);
+
+  const evtol_type_stats *stats = evtol_sim_type_stats(sim);
+  for (int i = 0; i < EVTOL_SIM_AIRCRAFT_TYPES; i++) {
+    EXPECT_EQ(stats[i].vehicle_count, 0);
+  }
+
+  evtol_sim_destroy(sim);
+}
@@ -0,0 +1,101 @@
+#include "../src/common.hpp"
+#include "../src/partition.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+
+/**
+ * @brief Verify a single shard gives exactly the same per-type results as
+ * running the simulator directly.
+ */
+TEST(PartitionTest, SingleShardMatchesSimulator) {
+  Scenario scenario;
+  scenario.duration_ms = MS_PER_HOUR;
+
+  TypeStats actual[MAX_AIRCRAFT_TYPES];
+  long long handoffs = -1;
+  ASSERT_TRUE(run_partitioned(scenario, 1, actual, &handoffs));
+  EXPECT_EQ(handoffs, 0);
+
+  Simulator sim(scenario.config);
+  sim.simulate(scenario.duration_ms);
+
+  TypeStats expected[MAX_AIRCRAFT_TYPES];
+  sim.collect_type_stats(expected);
+
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    EXPECT_EQ(actual[i].vehicle_count, expected[i].vehicle_count);
+    EXPECT_EQ(actual[i].flights, expected[i].flights);
+    EXPECT_EQ(actual[i].flight_ticks, expected[i].flight_ticks);
+    EXPECT_EQ(actual[i].chg_ticks, expected[i].chg_ticks);
+    EXPECT_EQ(actual[i].chg_sessions, expected[i].chg_sessions);
+    EXPECT_EQ(actual[i].faults, expected[i].faults);
+    EXPECT_EQ(actual[i].passenger_miles, expected[i].passenger_miles);
+    EXPECT_EQ(actual[i].flight_distance, expected[i].flight_distance);
+  }
+}
+
+/**
+ * @brief Verify a sharded run hands aircraft off between shards, loses none,
+ * and gives the same results every time.
+ */
+TEST(PartitionTest, ShardedRunIsDeterministic) {
+  Scenario scenario;
+  scenario.config.charger_count = 10;
+  scenario.duration_ms = MS_PER_HOUR;
+
+  TypeStats first[MAX_AIRCRAFT_TYPES];
+  TypeStats second[MAX_AIRCRAFT_TYPES];
+  long long first_handoffs = 0;
+  long long second_handoffs = 0;
+  ASSERT_TRUE(run_partitioned(scenario, 3, first, &first_handoffs));
+  ASSERT_TRUE(run_partitioned(scenario, 3, second, &second_handoffs));
+
+  EXPECT_GT(first_handoffs, 0);
+  EXPECT_EQ(first_handoffs, second_handoffs);
+
+  long long vehicles = 0;
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    vehicles += first[i].vehicle_count;
+    EXPECT_EQ(first[i].vehicle_count, second[i].vehicle_count);
+    EXPECT_EQ(first[i].flights, second[i].flights);
+    EXPECT_EQ(first[i].chg_sessions, second[i].chg_sessions);
+    EXPECT_EQ(first[i].faults, second[i].faults);
+    EXPECT_EQ(first[i].passenger_miles, second[i].passenger_miles);
+  }
+
+  EXPECT_EQ(vehicles, scenario.config.vehicle_count);
+}
+
+/**
+ * @brief Verify no shard is sent more aircraft than it has chargers free,
+ * counting those already waiting there and those still on their way.
+ */
+TEST(PartitionTest, HandoffsFitDestinationChargers) {
+  // Shards 1-3 have 3 free chargers each; 1 has 2 aircraft on their way and
+  // 2 has one waiting
+  std::vector<ShardReport> reports = {
+      {0, 6, 0}, {3, 0, 0}, {3, 1, 0}, {3, 0, 0}, {0, 2, 0}};
+  std::vector<int> pending = {0, 2, 0, 0, 0};
+  std::vector<ShardRoute> routes;
+  std::vector<int> quotas(reports.size(), -1);
+
+  match_handoffs(reports, pending, &routes, &quotas);
+
+  std::vector<int> received(reports.size(), 0);
+  int handed_off = 0;
+  for (const ShardRoute &route : routes) {
+    received[route.dst] += route.count;
+    handed_off += route.count;
+  }
+
+  for (size_t i = 0; i < reports.size(); i++) {
+    int spare = reports[i].free_chargers - reports[i].waiting - pending[i];
+    EXPECT_LE(received[i], spare > 0 ? spare : 0) << "shard " << i;
+  }
+  EXPECT_EQ(received[1], 1);
+  EXPECT_EQ(received[2], 2);
+  EXPECT_EQ(received[3], 3);
+  EXPECT_EQ(quotas[0], 6);
+  EXPECT_EQ(quotas[4], 0);
+  EXPECT_EQ(handed_off, 6);
+}
@@ -0,0 +1,51 @@
+#include "../src/scenario.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Golden-output corpus: every scenario in tests/scenarios/ must reproduce its
+// reports in tests/golden/ exactly. Paths are relative to the repo root,
+// which is where `make test` runs from.
+
+/**
+ * @brief Verify every scenario in the corpus still gives the same results.
+ *
+ * If a change in results is intended, regenerate with `make golden` and
+ * review the diff.
+ */
+TEST(RegressionTest, CorpusMatchesGolden) {
+  std::vector<std::filesystem::path> scenario_paths;
+  for (const auto &entry :
+       std::filesystem::directory_iterator("tests/scenarios")) {
+    if (entry.path().extension() == ".scn") {
+      scenario_paths.push_back(entry.path());
+    }
+  }
+  std::sort(scenario_paths.begin(), scenario_paths.end());
+
+  ASSERT_FALSE(scenario_paths.empty());
+
+  for (const auto &path : scenario_paths) {
+    SCOPED_TRACE(path.string());
+
+    Scenario scenario;
+    ASSERT_TRUE(load_scenario(path.c_str(), &scenario));
+
+    std::ostringstream actual;
+    run_scenario(scenario, actual);
+
+    std::filesystem::path golden_path =
+        "tests/golden" / path.stem().replace_extension(".csv");
+    std::ifstream golden_file(golden_path);
+    ASSERT_TRUE(golden_file) << "missing " << golden_path;
+
+    std::ostringstream expected;
+    expected << golden_file.rdbuf();
+
+    EXPECT_EQ(actual.str(), expected.str());
+  }
+}
@@ -0,0 +1,563 @@
+#include "../src/common.hpp"
+#include "../src/policy_comparison.hpp"
+#include "../src/rng.hpp"
+#include "../src/simulator.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Verify Rng reproduces the libc rand() sequence, so existing seeds
+ * still give the same simulations.
+ */
+TEST(RngTest, MatchesRand) {
+  srand(12452);
+  Rng rng(12452);
+
+  for (int i = 0; i < 100000; i++) {
+    ASSERT_EQ(rng.next(), rand());
+  }
+}
+
+/**
+ * @brief Verify that each policy in a comparison gets exactly the result it
+ * would have gotten running on its own.
+ *
+ * - The shared phase and the copy made at the split are invisible
+ * - All policies see the same faults (common random numbers)
+ */
+TEST(PolicyComparisonTest, MatchesIndependentRuns) {
+  PolicyComparison comparison(SimulatorConfig{});
+  comparison.simulate(MS_PER_HOUR * 3);
+
+  // The policies should actually have been contested at some point
+  EXPECT_GT(comparison.split_tick(), 0);
+
+  for (int i = 0; i < MAX_CHARGER_POLICIES; i++) {
+    Simulator sim(DEFAULT_VEHICLES, 12452, (ChargerPolicy)i);
+    sim.simulate(MS_PER_HOUR * 3);
+
+    FleetStats expected = sim.fleet_stats();
+    FleetStats actual = comparison.variant((ChargerPolicy)i).fleet_stats();
+
+    EXPECT_DOUBLE_EQ(actual.wait_per_session, expected.wait_per_session);
+    EXPECT_DOUBLE_EQ(actual.utilization, expected.utilization);
+    EXPECT_DOUBLE_EQ(actual.passenger_miles, expected.passenger_miles);
+    EXPECT_EQ(actual.faults, expected.faults);
+    EXPECT_EQ(actual.faults,
+              comparison.variant(POLICY__FIFO).fleet_stats().faults);
+  }
+}
+
+/**
+ * @brief Verify range prediction stops aircraft running out of battery
+ * mid-trip.
+ *
+ * - Without it, trips of maximum length strand from rounding alone
+ * - With it, no trips strand
+ */
+TEST(SimulatorTest, RangePredictionPreventsStranding) {
+  Simulator baseline(DEFAULT_VEHICLES, 12452);
+  baseline.simulate(MS_PER_HOUR * 3);
+  EXPECT_GT(baseline.fleet_stats().trips_stranded, 0);
+
+  Simulator predicted(DEFAULT_VEHICLES, 12452);
+  predicted.set_range_prediction(true);
+  predicted.simulate(MS_PER_HOUR * 3);
+  EXPECT_EQ(predicted.fleet_stats().trips_stranded, 0);
+}
+
+/**
+ * @brief Verify an environment with neutral conditions everywhere changes
+ * nothing, so the environment lookup itself doesn't perturb results.
+ */
+TEST(SimulatorTest, NeutralEnvironmentMatchesStillAir) {
+  Environment environment(4, MS_PER_HOUR, 3);
+
+  SimulatorConfig config;
+  Simulator still_air(config);
+  still_air.simulate(MS_PER_HOUR * 3);
+
+  config.environment = &environment;
+  Simulator neutral(config);
+  neutral.simulate(MS_PER_HOUR * 3);
+
+  FleetStats expected = still_air.fleet_stats();
+  FleetStats actual = neutral.fleet_stats();
+  EXPECT_EQ(actual.passenger_miles, expected.passenger_miles);
+  EXPECT_EQ(actual.wait_per_session, expected.wait_per_session);
+  EXPECT_EQ(actual.faults, expected.faults);
+}
+
+/**
+ * @brief Verify weather and airspace limits take effect.
+ *
+ * - A headwind cuts miles flown
+ * - A closed region holds its aircraft on the ground
+ */
+TEST(SimulatorTest, EnvironmentSlowsAndHoldsAircraft) {
+  SimulatorConfig config;
+  Simulator still_air(config);
+  still_air.simulate(MS_PER_HOUR);
+
+  Environment environment(2, MS_PER_HOUR, 1);
+  environment.cell(0, 0).headwind_mph = 20;
+  environment.cell(0, 1).airspace_capacity = 0;
+
+  config.environment = &environment;
+  Simulator degraded(config);
+  degraded.simulate(MS_PER_HOUR);
+
+  EXPECT_LT(degraded.fleet_stats().passenger_miles,
+            still_air.fleet_stats().passenger_miles);
+
+  for (int i = 0; i < degraded.vehicle_count(); i++) {
+    const Aircraft &vehicle = degraded.vehicles()[i];
+
+    if (vehicle.m_sim_region == 1) {
+      EXPECT_EQ(vehicle.m_sim_trips_started, 0);
+      EXPECT_EQ(vehicle.m_sim_ticks_held, degraded.ticks());
+    }
+  }
+}
+
+/**
+ * @brief Verify range prediction into a steady headwind shortens trips to
+ * what a full battery can fly, rather than turning every trip down.
+ */
+TEST(SimulatorTest, RangePredictionFliesIntoHeadwind) {
+  Environment environment(1, MS_PER_HOUR, 1);
+  environment.cell(0, 0).headwind_mph = 25;
+
+  SimulatorConfig config;
+  config.environment = &environment;
+  config.range_prediction = true;
+  Simulator sim(config);
+  sim.simulate(MS_PER_HOUR * 3);
+
+  TypeStats stats[MAX_AIRCRAFT_TYPES];
+  sim.collect_type_stats(stats);
+
+  for (int i = 0; i < MAX_AIRCRAFT_TYPES; i++) {
+    if (stats[i].vehicle_count > 0) {
+      EXPECT_GT(stats[i].flights, 0) << aircraft_type_str[i];
+    }
+  }
+  EXPECT_EQ(sim.fleet_stats().trips_stranded, 0);
+}
+
+/**
+ * @brief Verify adding aircraft past the fleet's capacity grows it, keeping
+ * the fleet in order, and fails cleanly once a caller's arena is full.
+ */
+TEST(SimulatorTest, AddVehicleGrowsFleet) {
+  SimulatorConfig config;
+  config.vehicle_count = 5;
+  Simulator sim(config);
+  sim.simulate(MS_PER_HOUR);
+
+  std::vector<Aircraft> before(sim.vehicles(), sim.vehicles() + 5);
+  for (int i = 0; i < 40; i++) {
+    ASSERT_TRUE(sim.add_vehicle(before[i % 5]));
+  }
+
+  ASSERT_EQ(sim.vehicle_count(), 45);
+  for (int i = 0; i < sim.vehicle_count(); i++) {
+    EXPECT_EQ(sim.vehicles()[i].m_sim_total_miles,
+              before[i % 5].m_sim_total_miles);
+  }
+  sim.simulate(MS_PER_HOUR);
+
+  Arena arena(Simulator::arena_bytes(5) + Simulator::arena_bytes(11));
+  Simulator bounded(config, &arena);
+  int added = 0;
+  while (added < 20 && bounded.add_vehicle(before[0])) {
+    added++;
+  }
+  EXPECT_EQ(added, 6);
+  EXPECT_EQ(bounded.vehicle_count(), 11);
+}
+
+/**
+ * @brief Number of aircraft waiting for a charger, counted the slow way.
+ */
+static int count_waiting(const Simulator &sim) {
+  int count = 0;
+  for (int i = 0; i < sim.vehicle_count(); i++) {
+    count += (MODE__WAITING_TO_CHARGE == sim.vehicles()[i].m_sim_mode);
+  }
+  return count;
+}
+
+/**
+ * @brief Verify handing aircraft off leaves the rest of the fleet in order,
+ * and the running count of waiting aircraft stays right throughout.
+ */
+TEST(SimulatorTest, TakeNextToChargeKeepsOrder) {
+  SimulatorConfig config;
+  config.vehicle_count = 40;
+  config.charger_count = 2;
+  Simulator sim(config);
+
+  for (int tick = 0; tick < MS_PER_HOUR / DEFAULT_STEP_MS; tick++) {
+    sim.step();
+    ASSERT_EQ(sim.waiting_count(), count_waiting(sim)) << "tick " << tick;
+  }
+  ASSERT_GT(sim.waiting_count(), 2);
+
+  std::vector<Aircraft> before(sim.vehicles(),
+                               sim.vehicles() + sim.vehicle_count());
+  Aircraft taken;
+  ASSERT_TRUE(sim.take_next_to_charge(&taken));
+  EXPECT_EQ(taken.m_sim_mode, MODE__WAITING_TO_CHARGE);
+  EXPECT_EQ(sim.waiting_count(), count_waiting(sim));
+
+  // The remaining fleet is the old one with exactly one aircraft left out
+  ASSERT_EQ(sim.vehicle_count(), (int)before.size() - 1);
+  int skipped = 0;
+  for (int i = 0; i < sim.vehicle_count(); i++) {
+    const Aircraft &old = before[i + skipped];
+    if (!skipped && (old.m_type != sim.vehicles()[i].m_type ||
+                     old.m_sim_total_miles !=
+                         sim.vehicles()[i].m_sim_total_miles)) {
+      skipped = 1;
+    }
+    EXPECT_EQ(sim.vehicles()[i].m_sim_total_miles,
+              before[i + skipped].m_sim_total_miles)
+        << "vehicle " << i;
+  }
+
+  ASSERT_TRUE(sim.add_vehicle(taken));
+  EXPECT_EQ(sim.waiting_count(), count_waiting(sim));
+  sim.simulate(MS_PER_HOUR);
+  EXPECT_EQ(sim.waiting_count(), count_waiting(sim));
+}
+
+/**
+ * @brief Verify the Reservation policy holds a freed charger for an inbound
+ * aircraft that booked one, where FIFO gives it to the aircraft waiting.
+ */
+TEST(SimulatorTest, ReservationHoldsChargerForInbound) {
+  int sessions[2][3];
+
+  for (int reserve = 0; reserve < 2; reserve++) {
+    SimulatorConfig config;
+    config.vehicle_count = 0;
+    config.vehicle_capacity = 3;
+    config.charger_count = 1;
+    config.step_ms = 1000;
+    config.charger_policy = reserve ? POLICY__RESERVATION : POLICY__FIFO;
+    Simulator sim(config);
+
+    // Charges for two ticks, then frees its charger
+    Alpha nearly_full;
+    nearly_full.m_sim_mode = MODE__WAITING_TO_CHARGE;
+    nearly_full.m_sim_rem_energy = nearly_full.m_max_battery_cap - 0.01;
+
+    Alpha empty;
+    empty.m_sim_mode = MODE__WAITING_TO_CHARGE;
+    empty.m_sim_rem_energy = 0;
+
+    // Lands in six ticks, having booked a charger when it took off
+    Alpha inbound;
+    inbound.m_sim_mode = MODE__FLYING;
+    inbound.m_sim_rem_energy = 100;
+    inbound.m_sim_trip_len = 0.2;
+    inbound.m_sim_trip_passenger_cnt = 1;
+    inbound.m_sim_est_arrival_tick = 6;
+    inbound.m_sim_charge_booked = true;
+
+    ASSERT_TRUE(sim.add_vehicle(nearly_full));
+    ASSERT_TRUE(sim.add_vehicle(empty));
+    ASSERT_TRUE(sim.add_vehicle(inbound));
+
+    for (int tick = 0; tick < 3; tick++) {
+      sim.step();
+    }
+    EXPECT_EQ(sim.free_chargers(), 0);
+    EXPECT_EQ(sim.vehicles()[2].m_sim_charger_held, (bool)reserve);
+    EXPECT_EQ(sim.vehicles()[1].m_sim_mode,
+              reserve ? MODE__WAITING_TO_CHARGE : MODE__CHARGING);
+
+    for (int tick = 0; tick < 10; tick++) {
+      sim.step();
+    }
+    for (int i = 0; i < 3; i++) {
+      sessions[reserve][i] = sim.vehicles()[i].m_sim_charging_sessions;
+    }
+    EXPECT_EQ(sim.waiting_count(), count_waiting(sim));
+  }
+
+  EXPECT_EQ(sessions[0][1], 1); // FIFO charges the aircraft waiting
+  EXPECT_EQ(sessions[0][2], 0);
+  EXPECT_EQ(sessions[1][1], 0); // Reservation charges the one landing
+  EXPECT_EQ(sessions[1][2], 1);
+}
+
+/**
+ * @brief Verify the hash trace has one entry per tick, ends on the final
+ * state, and picks up the first tick two runs differ at.
+ */
+TEST(SimulatorTest, HashTraceFindsDivergence) {
+  std::vector<uint64_t> fifo_trace;
+  Simulator fifo(SimulatorConfig{});
+  fifo.set_hash_trace(&fifo_trace);
+  fifo.simulate(MS_PER_HOUR * 3);
+
+  ASSERT_EQ(fifo_trace.size(), (size_t)fifo.ticks());
+  EXPECT_EQ(fifo_trace.back(), fifo.state_hash());
+
+  // Same fleet and faults; only charger allocation differs
+  std::vector<uint64_t> energy_trace;
+  Simulator energy(SimulatorConfig{});
+  energy.set_charger_policy(POLICY__LOWEST_ENERGY);
+  energy.set_hash_trace(&energy_trace);
+  energy.simulate(MS_PER_HOUR * 3);
+
+  size_t tick = 0;
+  while (tick < fifo_trace.size() && fifo_trace[tick] == energy_trace[tick]) {
+    tick++;
+  }
+  ASSERT_LT(tick, fifo_trace.size());
+
+  // Before then, every aircraft is in the same state
+  Simulator fifo_before(SimulatorConfig{});
+  Simulator energy_before(SimulatorConfig{});
+  energy_before.set_charger_policy(POLICY__LOWEST_ENERGY);
+  fifo_before.simulate(tick * DEFAULT_STEP_MS);
+  energy_before.simulate(tick * DEFAULT_STEP_MS);
+  EXPECT_EQ(fifo_before.state_hash(), energy_before.state_hash());
+  fifo_before.step();
+  energy_before.step();
+  EXPECT_NE(fifo_before.state_hash(), energy_before.state_hash());
+}
+
+/**
+ * @brief Number of ticks whose hash differs from the tick before.
+ */
+static int hash_changes(const std::vector<uint64_t> &trace) {
+  int changes = 0;
+  for (size_t tick = 1; tick < trace.size(); tick++) {
+    changes += trace[tick] != trace[tick - 1];
+  }
+  return changes;
+}
+
+/**
+ * @brief Verify hashing energy tracks the battery every tick, is kept up to
+ * date incrementally, and leaves the run itself alone.
+ */
+TEST(SimulatorTest, EnergyHashTracksBattery) {
+  std::vector<uint64_t> plain_trace;
+  Simulator plain(SimulatorConfig{});
+  plain.set_hash_trace(&plain_trace);
+  plain.simulate(MS_PER_HOUR);
+
+  std::vector<uint64_t> energy_trace;
+  Simulator energy(SimulatorConfig{});
+  energy.set_hash_trace(&energy_trace, true);
+  energy.simulate(MS_PER_HOUR);
+
+  EXPECT_EQ(energy_trace.back(), energy.state_hash());
+  EXPECT_NE(energy_trace.back(), plain_trace.back());
+
+  // Something is always flying or charging, so the battery hash moves every
+  // tick, while modes and counts only change now and then
+  EXPECT_EQ(hash_changes(energy_trace), (int)energy_trace.size() - 1);
+  EXPECT_LT(hash_changes(plain_trace), hash_changes(energy_trace));
+
+  plain.set_hash_trace(nullptr);
+  energy.set_hash_trace(nullptr);
+  EXPECT_EQ(energy.state_hash(), plain.state_hash());
+}
+
+/**
+ * @brief Verify a run resumed from a fleet image carries on exactly as if it
+ * had never stopped: same fleet, same random numbers, same charger queue.
+ */
+TEST(SimulatorTest, FleetImageResumesExactly) {
+  SimulatorConfig config;
+  config.vehicle_count = 60;
+  config.charger_policy = POLICY__SHORTEST_CHARGE;
+  std::string path = testing::TempDir() + "fleet_image_test.img";
+
+  Simulator warm(config);
+  warm.simulate(MS_PER_HOUR);
+  ASSERT_TRUE(warm.save_image(path.c_str()));
+
+  Simulator resumed(0, 1);
+  ASSERT_TRUE(resumed.load_image(path.c_str()));
+  EXPECT_EQ(resumed.ticks(), warm.ticks());
+  EXPECT_EQ(resumed.state_hash(), warm.state_hash());
+
+  // The mapped fleet has no room for hashes, so tracing moves it
+  std::vector<uint64_t> resumed_trace;
+  resumed.set_hash_trace(&resumed_trace);
+  resumed.simulate(MS_PER_HOUR * 2);
+
+  std::vector<uint64_t> expected_trace;
+  Simulator expected(config);
+  expected.set_hash_trace(&expected_trace);
+  expected.simulate(MS_PER_HOUR * 3);
+
+  ASSERT_EQ(resumed_trace.size() + warm.ticks(), expected_trace.size());
+  EXPECT_TRUE(std::equal(resumed_trace.begin(), resumed_trace.end(),
+                         expected_trace.begin() + warm.ticks()));
+
+  ASSERT_EQ(resumed.ticks(), expected.ticks());
+  ASSERT_EQ(resumed.vehicle_count(), expected.vehicle_count());
+  EXPECT_EQ(resumed.free_chargers(), expected.free_chargers());
+  EXPECT_EQ(resumed.state_hash(), expected.state_hash());
+  for (int i = 0; i < expected.vehicle_count(); i++) {
+    const Aircraft &a = resumed.vehicles()[i];
+    const Aircraft &e = expected.vehicles()[i];
+
+    EXPECT_EQ(a.m_sim_rem_energy, e.m_sim_rem_energy) << "vehicle " << i;
+    EXPECT_EQ(a.m_sim_total_miles, e.m_sim_total_miles) << "vehicle " << i;
+    EXPECT_EQ(a.m_sim_ticks_waiting_chg, e.m_sim_ticks_waiting_chg);
+    for (int mode = 0; mode < MAX_AIRCRAFT_MODES; mode++) {
+      EXPECT_EQ(a.m_mode_ticks[mode], e.m_mode_ticks[mode]);
+    }
+  }
+
+  // Saved without an environment, so it can't be loaded with one
+  Environment environment;
+  Simulator mismatched(0, 1);
+  EXPECT_FALSE(mismatched.load_image(path.c_str(), &environment));
+  EXPECT_FALSE(mismatched.load_image("/nonexistent/fleet.img"));
+  EXPECT_EQ(mismatched.vehicle_count(), 0);
+
+  // Only the one version loads, older or newer
+  uint32_t version = FLEET_IMAGE_VERSION + 1;
+  FILE *file = fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  fseek(file, 8, SEEK_SET); // After the magic
+  fwrite(&version, sizeof(version), 1, file);
+  fclose(file);
+  EXPECT_FALSE(mismatched.load_image(path.c_str()));
+
+  remove(path.c_str());
+}
+
+/**
+ * @brief Verify a simulator loaded from an image can save back over it,
+ * even though its fleet is still mapped from that file.
+ */
+TEST(SimulatorTest, FleetImageSavesOverItself) {
+  SimulatorConfig config;
+  config.vehicle_count = 60;
+  std::string path = testing::TempDir() + "fleet_image_self_test.img";
+
+  Simulator warm(config);
+  warm.simulate(MS_PER_HOUR);
+  ASSERT_TRUE(warm.save_image(path.c_str()));
+
+  // Nothing run, so most of the fleet's pages are still in the file
+  Simulator resumed(0, 1);
+  ASSERT_TRUE(resumed.load_image(path.c_str()));
+  ASSERT_TRUE(resumed.save_image(path.c_str()));
+  resumed.simulate(MS_PER_HOUR);
+  ASSERT_TRUE(resumed.save_image(path.c_str()));
+
+  Simulator reloaded(0, 1);
+  ASSERT_TRUE(reloaded.load_image(path.c_str()));
+  reloaded.simulate(MS_PER_HOUR);
+
+  Simulator expected(config);
+  expected.simulate(MS_PER_HOUR * 3);
+  ASSERT_EQ(reloaded.ticks(), expected.ticks());
+  EXPECT_EQ(reloaded.state_hash(), expected.state_hash());
+  for (int i = 0; i < expected.vehicle_count(); i++) {
+    EXPECT_EQ(reloaded.vehicles()[i].m_sim_rem_energy,
+              expected.vehicles()[i].m_sim_rem_energy)
+        << "vehicle " << i;
+  }
+
+  remove(path.c_str());
+}
+
+/**
+ * @brief Verify an image only loads with the environment it was saved with,
+ * down to the conditions in each cell, not just the grid size.
+ */
+TEST(SimulatorTest, FleetImageChecksEnvironment) {
+  Environment environment(2, MS_PER_HOUR, 2);
+  environment.cell(1, 0).headwind_mph = 20;
+
+  SimulatorConfig config;
+  config.vehicle_count = 20;
+  config.environment = &environment;
+  std::string path = testing::TempDir() + "fleet_image_env_test.img";
+
+  Simulator warm(config);
+  warm.simulate(MS_PER_HOUR);
+  ASSERT_TRUE(warm.save_image(path.c_str()));
+
+  Environment same = environment;
+  Simulator resumed(0, 1);
+  EXPECT_TRUE(resumed.load_image(path.c_str(), &same));
+
+  Environment windier = environment;
+  windier.cell(1, 0).headwind_mph = 21;
+  Simulator mismatched(0, 1);
+  EXPECT_FALSE(mismatched.load_image(path.c_str(), &windier));
+  EXPECT_FALSE(mismatched.load_image(path.c_str()));
+  EXPECT_EQ(mismatched.vehicle_count(), 0);
+
+  remove(path.c_str());
+}
+
+/**
+ * @brief Verify resetting the stats after loading an image leaves the
+ * warm-up out of the reports without changing how the run carries on.
+ */
+TEST(SimulatorTest, ResetStatsLeavesOutWarmUp) {
+  SimulatorConfig config;
+  config.vehicle_count = 60;
+  std::string path = testing::TempDir() + "fleet_image_reset_test.img";
+
+  Simulator warm(config);
+  warm.simulate(MS_PER_HOUR);
+  ASSERT_TRUE(warm.save_image(path.c_str()));
+
+  Simulator resumed(0, 1);
+  ASSERT_TRUE(resumed.load_image(path.c_str()));
+  resumed.reset_stats();
+  EXPECT_EQ(resumed.stats_start_tick(), warm.ticks());
+  resumed.simulate(MS_PER_HOUR * 2);
+
+  Simulator expected(config);
+  expected.simulate(MS_PER_HOUR * 3);
+  EXPECT_EQ(expected.stats_start_tick(), 0);
+
+  ASSERT_EQ(resumed.ticks(), expected.ticks());
+  for (int i = 0; i < expected.vehicle_count(); i++) {
+    const Aircraft &a = resumed.vehicles()[i];
+    const Aircraft &e = expected.vehicles()[i];
+    const Aircraft &w = warm.vehicles()[i];
+
+    EXPECT_EQ(a.m_sim_mode, e.m_sim_mode) << "vehicle " << i;
+    EXPECT_EQ(a.m_sim_rem_energy, e.m_sim_rem_energy) << "vehicle " << i;
+    EXPECT_EQ(a.m_sim_trips_started,
+              e.m_sim_trips_started - w.m_sim_trips_started);
+    EXPECT_EQ(a.m_sim_charging_sessions,
+              e.m_sim_charging_sessions - w.m_sim_charging_sessions);
+
+    int total_ticks = 0;
+    for (int mode = 0; mode < MAX_AIRCRAFT_MODES; mode++) {
+      EXPECT_EQ(a.m_mode_ticks[mode],
+                e.m_mode_ticks[mode] - w.m_mode_ticks[mode]);
+      total_ticks += a.m_mode_ticks[mode];
+    }
+    EXPECT_EQ(total_ticks, resumed.ticks() - resumed.stats_start_tick());
+  }
+
+  FleetStats stats = resumed.fleet_stats();
+  EXPECT_GT(stats.utilization, 0.0);
+  EXPECT_LE(stats.utilization, 1.0);
+
+  remove(path.c_str());
+}
@@ -0,0 +1,240 @@
+"""Run two simulator builds or engine modes on the same scenario and diff them.
+
+Each side is a program followed by its own options. Both sides run with the
+shared arguments first, so a shared --scenario can't reset a side's
+options, then the side's options, then --golden (the full regression
+report) and --hash-trace (a fleet state hash per tick). Options that a
+later --scenario would silently reset are rejected. The reports are
+compared field by field, with numeric fields allowed to differ by the given
+tolerances. If the hash traces differ, both
+sides are rerun up to the first diverging tick and the aircraft whose state
+differs there are listed.
+
+When neither side runs on the behavior engine, the hashes also cover each
+aircraft's battery energy (--hash-energy), so a difference in it shows up on
+the tick it happens rather than when it first changes a mode or a count.
+--no-hash-energy leaves it out, e.g. for builds older than --hash-energy.
+
+Traces are lined up by the tick they start from, so a run resumed from a
+fleet image (--load-image) can be checked against a run from the start:
+only the ticks both sides ran are compared, and ticks are numbered from the
+start of the original run.
+
+    python3 tools/diff_results.py --a ./build/joby \\
+        --b './build/joby --behavior-engine' \\
+        -- --scenario tests/scenarios/contention.scn
+    python3 tools/diff_results.py --a /tmp/old/joby --b ./build/joby \\
+        --rel-tol 1e-9 -- --scenario tests/scenarios/long_horizon.scn
+
+Exit status is 0 if everything matches, 1 if the reports differ beyond the
+tolerances, and 2 if the reports match but the per-tick state diverged.
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+
+STATE_HEADER = 'VehicleNumber,'
+STATE_FIELDS = ['Mode', 'Trips', 'ChgSessions', 'Faults']
+ENERGY_FIELD = 'Energy'
+ENGINE_FLAG = '--behavior-engine'
+SCENARIO_FLAG = '--scenario'
+SCENARIO_OPTIONS = ['--policy', '--range-prediction', '--environment',
+                    '--duration']
+MAX_LISTED = 10
+
+
+def side_argv(command, shared, extra):
+    """Program, shared arguments, the side's own options, then `extra`."""
+    words = shlex.split(command)
+    argv = words[:1] + shared + words[1:] + extra
+    scenario = max((i for i, word in enumerate(argv) if word == SCENARIO_FLAG),
+                   default=-1)
+    reset = [word for word in argv[:scenario] if word in SCENARIO_OPTIONS]
+    if reset:
+        sys.exit('%s: %s before %s would be reset by it' %
+                 (' '.join(argv), ', '.join(reset), SCENARIO_FLAG))
+    return argv
+
+
+def run(command, shared, extra=()):
+    """Run one side and return its stdout, exiting if it fails."""
+    argv = side_argv(command, shared, list(extra))
+    result = subprocess.run(argv, capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.exit('%s failed (%d):\n%s' %
+                 (' '.join(argv), result.returncode, result.stderr))
+    return result.stdout
+
+
+def to_number(field):
+    try:
+        return float(field)
+    except ValueError:
+        return None
+
+
+def fields_match(a, b, rel_tol, abs_tol):
+    if a == b:
+        return True
+    x = to_number(a)
+    y = to_number(b)
+    if x is None or y is None:
+        return False
+    return abs(x - y) <= abs_tol + rel_tol * max(abs(x), abs(y))
+
+
+def diff_reports(a_lines, b_lines, rel_tol, abs_tol):
+    """Print report lines that differ beyond the tolerances; count them."""
+    differences = 0
+    section = ''
+
+    for num in range(max(len(a_lines), len(b_lines))):
+        a = a_lines[num] if num < len(a_lines) else '<missing>'
+        b = b_lines[num] if num < len(b_lines) else '<missing>'
+        a_fields = a.rstrip(',').split(',')
+        b_fields = b.rstrip(',').split(',')
+
+        if all(to_number(f) is None for f in a_fields):
+            section = a
+
+        if len(a_fields) == len(b_fields) and all(
+                fields_match(x, y, rel_tol, abs_tol)
+                for x, y in zip(a_fields, b_fields)):
+            continue
+
+        differences += 1
+        if differences <= MAX_LISTED:
+            print('report line %d (under %s):' % (num + 1, section))
+            print('  a: ' + a)
+            print('  b: ' + b)
+
+    if differences > MAX_LISTED:
+        print('... %d report lines differ in all' % differences)
+    return differences
+
+
+def read_trace(path):
+    """Read a hash trace; return (step_ms, start_tick, list of hashes)."""
+    step_ms = None
+    start_tick = 0  # Traces before version 3 always start at 0
+    hashes = []
+    with open(path) as trace:
+        for line in trace:
+            words = line.split()
+            if len(words) == 2:
+                if words[0] == 'step_ms':
+                    step_ms = int(words[1])
+                elif words[0] == 'start_tick':
+                    start_tick = int(words[1])
+            elif len(words) == 1:
+                hashes.append(words[0])
+    return step_ms, start_tick, hashes
+
+
+def first_divergence(a_start, a_hashes, b_start, b_hashes):
+    """Return (first tick whose hashes differ or None, ticks compared).
+
+    Only the ticks both traces cover are compared; a trace ending early
+    counts as diverging at its end.
+    """
+    start = max(a_start, b_start)
+    a_end = a_start + len(a_hashes)
+    b_end = b_start + len(b_hashes)
+    for tick in range(start, min(a_end, b_end)):
+        if a_hashes[tick - a_start] != b_hashes[tick - b_start]:
+            return tick, tick - start
+    if a_end != b_end:
+        return min(a_end, b_end), min(a_end, b_end) - start
+    return None, max(0, a_end - start)
+
+
+def vehicle_states(output):
+    """Parse the --vehicle-state report into {vehicle: row dict}."""
+    lines = output.splitlines()
+    start = max(i for i, line in enumerate(lines)
+                if line.startswith(STATE_HEADER))
+    header = lines[start].split(',')
+    states = {}
+    for line in lines[start + 1:]:
+        row = dict(zip(header, line.split(',')))
+        states[int(row['VehicleNumber'])] = row
+    return states
+
+
+def diff_vehicles(args, tick, step_ms, starts, energy):
+    """Rerun both sides to the end of `tick` and list diverged aircraft."""
+    a_start, b_start = starts
+    a_states = vehicle_states(run(args.a, args.args, [
+        '--duration', str((tick + 1 - a_start) * step_ms), '--vehicle-state']))
+    b_states = vehicle_states(run(args.b, args.args, [
+        '--duration', str((tick + 1 - b_start) * step_ms), '--vehicle-state']))
+    fields = STATE_FIELDS + ([ENERGY_FIELD] if energy else [])
+
+    diverged = [v for v in sorted(set(a_states) | set(b_states))
+                if any(a_states.get(v, {}).get(f) != b_states.get(v, {}).get(f)
+                       for f in fields)]
+
+    print('%d aircraft differ at the end of tick %d:' % (len(diverged), tick))
+    for vehicle in diverged[:MAX_LISTED]:
+        for side, states in (('a', a_states), ('b', b_states)):
+            row = states.get(vehicle)
+            print('  %s: %s' % (side, ','.join(row.values()) if row
+                                else '%d <missing>' % vehicle))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument('--a', required=True, help='first command')
+    parser.add_argument('--b', required=True, help='second command')
+    parser.add_argument('--rel-tol', type=float, default=0.0,
+                        help='relative tolerance for numeric report fields')
+    parser.add_argument('--abs-tol', type=float, default=0.0,
+                        help='absolute tolerance for numeric report fields')
+    parser.add_argument('--no-hash-energy', action='store_true',
+                        help='leave battery energy out of the state hashes')
+    parser.add_argument('args', nargs='*',
+                        help='arguments for both sides (after --)')
+    args = parser.parse_args()
+
+    # Only the state machine works out energy every tick
+    energy = not args.no_hash_energy and not any(
+        ENGINE_FLAG in shlex.split(words)
+        for words in [args.a, args.b] + args.args)
+    hash_args = ['--hash-energy'] if energy else []
+
+    with tempfile.TemporaryDirectory() as tmp:
+        traces = []
+        reports = []
+        for side, command in (('a', args.a), ('b', args.b)):
+            trace = os.path.join(tmp, side + '.trace')
+            reports.append(run(command, args.args, hash_args +
+                               ['--golden', '--hash-trace', trace]))
+            traces.append(read_trace(trace))
+
+    differences = diff_reports(reports[0].splitlines(),
+                               reports[1].splitlines(),
+                               args.rel_tol, args.abs_tol)
+
+    (step_ms, a_start, a_hashes), (_, b_start, b_hashes) = traces
+    tick, compared = first_divergence(a_start, a_hashes, b_start, b_hashes)
+
+    if tick is None:
+        print('state matches at all %d ticks' % compared)
+    else:
+        print('state first diverges at tick %d (%d ms)' %
+              (tick, tick * step_ms))
+        if tick < min(a_start + len(a_hashes), b_start + len(b_hashes)):
+            diff_vehicles(args, tick, step_ms, (a_start, b_start), energy)
+
+    if differences:
+        return 1
+    return 0 if tick is None else 2
+
+
+if __name__ == '__main__':
+    sys.exit(main())
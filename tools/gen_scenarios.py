@@ -0,0 +1,214 @@
+"""Generate scenario files for the simulator.
+
+Each family comes in two scales: 'full' is the realistic workload used for
+benchmarking, 'test' is a scaled-down version that runs in a second or so and
+is checked into tests/scenarios/ as the regression corpus.
+
+The state machine's cost grows faster than the fleet, because every charge
+that finishes scans the fleet for the next aircraft to charge. Full scale is
+sized so each family runs in one to a few minutes on it (see FAMILIES), with
+one exception: fleet_10m only runs on the behavior engine, and even there
+takes over an hour. Its full-scale scenario file says so in a comment.
+
+    python3 tools/gen_scenarios.py --scale test --out tests/scenarios
+    python3 tools/gen_scenarios.py --scale full --out /tmp/scenarios contention
+    make golden   # after regenerating the test corpus
+
+Families with weather also get a <name>.env environment file next to the
+scenario.
+"""
+
+import argparse
+import os
+import sys
+
+SCENARIO_VERSION = 1
+ENVIRONMENT_VERSION = 1
+HOUR_MS = 60 * 60 * 1000
+DAY_MS = 24 * HOUR_MS
+POLICIES = ['FIFO', 'LowestEnergy', 'ShortestCharge', 'EarliestArrival',
+            'Reservation']
+AIRSPACE_UNLIMITED = 65535
+
+# name: (description, full scale, test scale)
+# Scale fields: vehicles, chargers, duration_ms, type_weights
+# Full scale run times are for one core on the state machine: baseline
+# instant, contention ~1 min, long_horizon ~2.5 min, skewed_mix ~1 min,
+# echo_heavy ~1.5 min, degraded_day ~1.5 min. fleet_10m is the exception
+# (see FULL_SCALE_WARNINGS): on the behavior engine 1M aircraft take ~6 min
+# and 650MB, and 10M take over an hour and ~6.5GB.
+FAMILIES = {
+    'baseline': (
+        'The original 20 vehicle, 3 charger, 3 hour run',
+        (20, 3, 3 * HOUR_MS, [1, 1, 1, 1, 1]),
+        (20, 3, 3 * HOUR_MS, [1, 1, 1, 1, 1]),
+    ),
+    'fleet_10m': (
+        'Very large fleet at the baseline charger ratio',
+        (10_000_000, 1_500_000, 3 * HOUR_MS, [1, 1, 1, 1, 1]),
+        (1_000, 150, 1 * HOUR_MS, [1, 1, 1, 1, 1]),
+    ),
+    'contention': (
+        'Far more aircraft than chargers',
+        (20_000, 200, 6 * HOUR_MS, [1, 1, 1, 1, 1]),
+        (200, 2, 3 * HOUR_MS, [1, 1, 1, 1, 1]),
+    ),
+    'long_horizon': (
+        'Multi-day run',
+        (1_000, 150, 14 * DAY_MS, [1, 1, 1, 1, 1]),
+        (20, 3, 2 * DAY_MS, [1, 1, 1, 1, 1]),
+    ),
+    'skewed_mix': (
+        'Fleet dominated by one long-range type',
+        (40_000, 6_000, 3 * HOUR_MS, [70, 20, 5, 4, 1]),
+        (200, 30, 3 * HOUR_MS, [70, 20, 5, 4, 1]),
+    ),
+    'echo_heavy': (
+        'Fleet dominated by the slow, fault-prone type',
+        (40_000, 6_000, 3 * HOUR_MS, [0, 0, 0, 1, 9]),
+        (200, 30, 3 * HOUR_MS, [0, 0, 0, 1, 9]),
+    ),
+    'degraded_day': (
+        'Cold front with headwinds and a fog-bound region',
+        (40_000, 6_000, 3 * HOUR_MS, [1, 1, 1, 1, 1]),
+        (40, 6, 3 * HOUR_MS, [1, 1, 1, 1, 1]),
+    ),
+}
+
+# Families whose full scale needs more than a few minutes on the state
+# machine. name: comment line for the full-scale scenario file
+FULL_SCALE_WARNINGS = {
+    'fleet_10m': ('Full scale only runs with --behavior-engine, and takes '
+                  'over an hour and ~6.5GB of memory'),
+}
+
+
+def degraded_day_environment(vehicles):
+    """Four regions over three hours in 15 minute buckets. A cold front
+    brings a strong headwind through region 0 in the first hour, it's cold
+    everywhere until mid-morning, and fog closes most of region 2's airspace
+    in the second hour."""
+    regions = 4
+    buckets = 12
+    fog_capacity = max(1, vehicles // (regions * 20))
+
+    lines = [
+        f'regions {regions}',
+        f'bucket_ms {15 * 60 * 1000}',
+        f'buckets {buckets}',
+        f'fill 0 20 {AIRSPACE_UNLIMITED}',
+    ]
+
+    for bucket in range(buckets):
+        for region in range(regions):
+            headwind = 25 if region == 0 and bucket < 4 else 5
+            temperature = -5 + 3 * bucket if bucket < 8 else 20
+            capacity = AIRSPACE_UNLIMITED
+            if region == 2 and 4 <= bucket < 8:
+                capacity = fog_capacity
+            lines.append(f'cell {bucket} {region} {headwind} {temperature} '
+                         f'{capacity}')
+
+    return lines
+
+
+# Families that run with weather and airspace limits
+# name: function(vehicles) returning the environment's lines
+ENVIRONMENTS = {
+    'degraded_day': degraded_day_environment,
+}
+
+# Variants run a family with a non-default policy or range prediction
+# name: (family, charger_policy, range_prediction)
+VARIANTS = {
+    'baseline_range_prediction': ('baseline', 'FIFO', 1),
+    'contention_lowest_energy': ('contention', 'LowestEnergy', 0),
+    'contention_shortest_charge': ('contention', 'ShortestCharge', 0),
+    'contention_earliest_arrival': ('contention', 'EarliestArrival', 0),
+    'contention_reservation': ('contention', 'Reservation', 0),
+    'contention_range_prediction': ('contention', 'FIFO', 1),
+}
+
+
+def family_of(name):
+    return VARIANTS.get(name, (name, 'FIFO', 0))[0]
+
+
+def scale_of(family, scale):
+    description, full, test = FAMILIES[family]
+    return full if scale == 'full' else test
+
+
+def environment_text(name, scale):
+    family = family_of(name)
+    vehicles = scale_of(family, scale)[0]
+
+    return '\n'.join([
+        f'# eVTOL simulator environment: {family} ({scale} scale)',
+        f'# Generated by tools/gen_scenarios.py',
+        f'version {ENVIRONMENT_VERSION}',
+        '# cell <bucket> <region> <headwind_mph> <temperature_c> <capacity>',
+    ] + ENVIRONMENTS[family](vehicles) + [''])
+
+
+def scenario_text(name, scale, seed):
+    family, policy, range_prediction = VARIANTS.get(name, (name, 'FIFO', 0))
+    description = FAMILIES[family][0]
+    vehicles, chargers, duration_ms, weights = scale_of(family, scale)
+    environment = []
+    if family in ENVIRONMENTS:
+        environment = [f'environment {family}.env']
+    warning = []
+    if scale == 'full' and family in FULL_SCALE_WARNINGS:
+        warning = [f'# {FULL_SCALE_WARNINGS[family]}']
+
+    return '\n'.join([
+        f'# eVTOL simulator scenario: {name} ({scale} scale)',
+        f'# {description}',
+    ] + warning + [
+        f'# Generated by tools/gen_scenarios.py',
+        f'version {SCENARIO_VERSION}',
+        f'seed {seed}',
+        f'vehicles {vehicles}',
+        f'chargers {chargers}',
+        f'duration_ms {duration_ms}',
+        f'step_ms 100',
+        f'type_weights {" ".join(str(w) for w in weights)}',
+        f'charger_policy {policy}',
+        f'range_prediction {range_prediction}',
+    ] + environment + [''])
+
+
+def main():
+    names = list(FAMILIES) + list(VARIANTS)
+
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--scale', choices=['test', 'full'], default='test')
+    parser.add_argument('--out', default='.')
+    parser.add_argument('--seed', type=int, default=12452)
+    parser.add_argument('names', nargs='*',
+                        help='scenarios to generate (default: all)')
+    args = parser.parse_args()
+
+    for name in args.names:
+        if name not in names:
+            parser.error(f'unknown scenario {name!r} (choose from {names})')
+
+    os.makedirs(args.out, exist_ok=True)
+
+    for name in args.names or names:
+        path = os.path.join(args.out, f'{name}.scn')
+        with open(path, 'w') as f:
+            f.write(scenario_text(name, args.scale, args.seed))
+        print(path, file=sys.stderr)
+
+        family = family_of(name)
+        if family in ENVIRONMENTS:
+            path = os.path.join(args.out, f'{family}.env')
+            with open(path, 'w') as f:
+                f.write(environment_text(name, args.scale))
+            print(path, file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()